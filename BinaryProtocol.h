@@ -0,0 +1,249 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <array>
+#include <bit>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <utility>
+#include <algorithm>
+
+/**
+ * \brief	Name of the binary frame format, offered in the "frame_formats" of the registration message.
+ *	A relay that accepts it may send binary frames as well as JSON text frames, a relay that does not know it ignores the field and sends JSON only.
+ */
+inline constexpr std::string_view BinaryProtocolName{ "binary_v1" };
+
+/**
+ * \brief	Flag bits of a binary frame, the second byte.
+ */
+namespace BinaryFrameFlags
+{
+	inline constexpr uint8_t IsDown{ 1 << 0 };
+	inline constexpr uint8_t HasCommand{ 1 << 1 };
+	inline constexpr uint8_t HasTimestamp{ 1 << 2 };
+	inline constexpr uint8_t HasVelocity{ 1 << 3 };
+	inline constexpr uint8_t HasDisplacement{ 1 << 4 };
+	inline constexpr uint8_t HasScroll{ 1 << 5 };
+	inline constexpr uint8_t Known{ IsDown | HasCommand | HasTimestamp | HasVelocity | HasDisplacement | HasScroll };
+}
+
+/**
+ * \brief	A decoded binary frame, the counterpart of a JSON command and/or "move_vector" message.
+ * \remarks	Wire format, little-endian, the optional fields follow the header in this order when their flag is set:
+ *	<p>u8 version, u8 flags, u8 command id (the command keycode), u8 client slot, u16 sequence number</p>
+ *	<p>[u32 sender timestamp, microseconds] [f32 vx, f32 vy] [f32 dx, f32 dy] [f32 scroll]</p>
+ *	The sender timestamp is the low 32 bits of the sender's Unix time in microseconds, so the receiver can time the network leg (wrapping every 71 minutes).
+ *	A plain command is 6 bytes, the JSON equivalent with a client_id is about 80.
+ */
+struct BinaryFrame
+{
+	static constexpr uint8_t Version{ 1 };
+	static constexpr std::size_t HeaderSize{ 6 };
+	static constexpr std::size_t MaxSize{ HeaderSize + 4 + 8 + 8 + 4 };
+	// The client slot of a frame that is not from a particular client, as for a JSON message without a "client_id".
+	static constexpr uint8_t NoClientSlot{ 0xFF };
+	// Bounds of the float fields, a frame with a value outside of [-Max, Max] (or NaN) does not decode. Far beyond any real input,
+	// they keep the pointer and scroll motion's whole-pixel and whole-unit conversions in range.
+	static constexpr float MaxVelocity{ 100'000.0f };
+	static constexpr float MaxDisplacement{ 100'000.0f };
+	static constexpr float MaxScroll{ 1'000.0f };
+
+	uint8_t Flags{};
+	uint8_t CommandId{};
+	uint8_t ClientSlot{ NoClientSlot };
+	uint16_t Sequence{};
+	uint32_t Timestamp{};
+	// Same units and meaning as the fields of a "move_vector" message.
+	float VelocityX{};
+	float VelocityY{};
+	float DisplacementX{};
+	float DisplacementY{};
+	float Scroll{};
+
+	[[nodiscard]] constexpr bool Has(const uint8_t flag) const noexcept
+	{
+		return (Flags & flag) != 0;
+	}
+
+	[[nodiscard]] constexpr auto GetEncodedSize() const noexcept -> std::size_t
+	{
+		return HeaderSize
+			+ (Has(BinaryFrameFlags::HasTimestamp) ? 4 : 0)
+			+ (Has(BinaryFrameFlags::HasVelocity) ? 8 : 0)
+			+ (Has(BinaryFrameFlags::HasDisplacement) ? 8 : 0)
+			+ (Has(BinaryFrameFlags::HasScroll) ? 4 : 0);
+	}
+
+	friend constexpr bool operator==(const BinaryFrame&, const BinaryFrame&) noexcept = default;
+};
+
+namespace detail
+{
+	constexpr void WriteLittleEndian(std::span<uint8_t> out, std::size_t& pos, const uint32_t value, const std::size_t width) noexcept
+	{
+		for (std::size_t i{}; i < width; ++i)
+			out[pos++] = static_cast<uint8_t>(value >> (8 * i));
+	}
+
+	[[nodiscard]] constexpr auto ReadLittleEndian(const std::span<const uint8_t> in, std::size_t& pos, const std::size_t width) noexcept -> uint32_t
+	{
+		uint32_t value{};
+		for (std::size_t i{}; i < width; ++i)
+			value |= static_cast<uint32_t>(in[pos++]) << (8 * i);
+		return value;
+	}
+}
+
+/**
+ * \brief	Encodes the frame into 'out', which must hold at least <c>frame.GetEncodedSize()</c> bytes.
+ * \return	The number of bytes written, zero if 'out' is too small.
+ */
+[[nodiscard]] constexpr auto EncodeBinaryFrame(const BinaryFrame& frame, const std::span<uint8_t> out) noexcept -> std::size_t
+{
+	if (out.size() < frame.GetEncodedSize())
+		return 0;
+
+	std::size_t pos{};
+	detail::WriteLittleEndian(out, pos, BinaryFrame::Version, 1);
+	detail::WriteLittleEndian(out, pos, frame.Flags & BinaryFrameFlags::Known, 1);
+	detail::WriteLittleEndian(out, pos, frame.CommandId, 1);
+	detail::WriteLittleEndian(out, pos, frame.ClientSlot, 1);
+	detail::WriteLittleEndian(out, pos, frame.Sequence, 2);
+	if (frame.Has(BinaryFrameFlags::HasTimestamp))
+		detail::WriteLittleEndian(out, pos, frame.Timestamp, 4);
+	const auto writeFloat = [&](const float value) { detail::WriteLittleEndian(out, pos, std::bit_cast<uint32_t>(value), 4); };
+	if (frame.Has(BinaryFrameFlags::HasVelocity))
+	{
+		writeFloat(frame.VelocityX);
+		writeFloat(frame.VelocityY);
+	}
+	if (frame.Has(BinaryFrameFlags::HasDisplacement))
+	{
+		writeFloat(frame.DisplacementX);
+		writeFloat(frame.DisplacementY);
+	}
+	if (frame.Has(BinaryFrameFlags::HasScroll))
+		writeFloat(frame.Scroll);
+	return pos;
+}
+
+/**
+ * \brief	Decodes a binary frame, empty optional if it is not a well-formed frame of this version (wrong version, unknown flags, wrong length,
+ *	or a float field that is NaN, infinite, or outside of its BinaryFrame::Max* bound).
+ */
+[[nodiscard]] constexpr auto DecodeBinaryFrame(const std::span<const uint8_t> in) noexcept -> std::optional<BinaryFrame>
+{
+	if (in.size() < BinaryFrame::HeaderSize)
+		return {};
+
+	std::size_t pos{};
+	if (detail::ReadLittleEndian(in, pos, 1) != BinaryFrame::Version)
+		return {};
+	BinaryFrame frame;
+	frame.Flags = static_cast<uint8_t>(detail::ReadLittleEndian(in, pos, 1));
+	if ((frame.Flags & ~BinaryFrameFlags::Known) != 0 || in.size() != frame.GetEncodedSize())
+		return {};
+	frame.CommandId = static_cast<uint8_t>(detail::ReadLittleEndian(in, pos, 1));
+	frame.ClientSlot = static_cast<uint8_t>(detail::ReadLittleEndian(in, pos, 1));
+	frame.Sequence = static_cast<uint16_t>(detail::ReadLittleEndian(in, pos, 2));
+	if (frame.Has(BinaryFrameFlags::HasTimestamp))
+		frame.Timestamp = detail::ReadLittleEndian(in, pos, 4);
+	const auto readFloat = [&]() { return std::bit_cast<float>(detail::ReadLittleEndian(in, pos, 4)); };
+	// False for NaN as well, every comparison with it is false.
+	const auto isInRange = [](const float value, const float max) { return value >= -max && value <= max; };
+	if (frame.Has(BinaryFrameFlags::HasVelocity))
+	{
+		frame.VelocityX = readFloat();
+		frame.VelocityY = readFloat();
+		if (!isInRange(frame.VelocityX, BinaryFrame::MaxVelocity) || !isInRange(frame.VelocityY, BinaryFrame::MaxVelocity))
+			return {};
+	}
+	if (frame.Has(BinaryFrameFlags::HasDisplacement))
+	{
+		frame.DisplacementX = readFloat();
+		frame.DisplacementY = readFloat();
+		if (!isInRange(frame.DisplacementX, BinaryFrame::MaxDisplacement) || !isInRange(frame.DisplacementY, BinaryFrame::MaxDisplacement))
+			return {};
+	}
+	if (frame.Has(BinaryFrameFlags::HasScroll))
+	{
+		frame.Scroll = readFloat();
+		if (!isInRange(frame.Scroll, BinaryFrame::MaxScroll))
+			return {};
+	}
+	return frame;
+}
+
+namespace detail
+{
+	[[nodiscard]] constexpr bool IsRoundTripExact(const BinaryFrame& frame) noexcept
+	{
+		std::array<uint8_t, BinaryFrame::MaxSize> buffer{};
+		const auto size = EncodeBinaryFrame(frame, buffer);
+		const auto decoded = DecodeBinaryFrame(std::span{ buffer }.first(size));
+		return size == frame.GetEncodedSize() && decoded && *decoded == frame;
+	}
+}
+
+static_assert(detail::IsRoundTripExact({ .Flags = BinaryFrameFlags::HasCommand | BinaryFrameFlags::IsDown, .CommandId = 20, .ClientSlot = 3, .Sequence = 0xBEEF }));
+static_assert(detail::IsRoundTripExact({ .Flags = BinaryFrameFlags::Known, .CommandId = 1, .Sequence = 7, .Timestamp = 0xDEADBEEF,
+	.VelocityX = -812.5f, .VelocityY = 3.25f, .DisplacementX = 0.125f, .DisplacementY = -4.0f, .Scroll = -1.5f }));
+static_assert(detail::IsRoundTripExact({ .Flags = BinaryFrameFlags::HasScroll, .Scroll = 0.75f }));
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 6>{ 2, 0, 0, 0, 0, 0 }), "Wrong version must not decode.");
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 6>{ 1, BinaryFrameFlags::HasScroll, 0, 0, 0, 0 }), "Truncated frame must not decode.");
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 6>{ 1, 0x80, 0, 0, 0, 0 }), "Unknown flags must not decode.");
+// Scroll of NaN (0x7FC00000), +infinity (0x7F800000), and 1e6 (0x49742400), past MaxScroll.
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 10>{ 1, BinaryFrameFlags::HasScroll, 0, 0, 0, 0, 0x00, 0x00, 0xC0, 0x7F }), "NaN must not decode.");
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 10>{ 1, BinaryFrameFlags::HasScroll, 0, 0, 0, 0, 0x00, 0x00, 0x80, 0x7F }), "Infinity must not decode.");
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 10>{ 1, BinaryFrameFlags::HasScroll, 0, 0, 0, 0, 0x00, 0x24, 0x74, 0x49 }), "Out of range must not decode.");
+static_assert(!DecodeBinaryFrame(std::array<uint8_t, 14>{ 1, BinaryFrameFlags::HasVelocity, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x00, 0x80, 0xFF }), "-Infinity must not decode.");
+
+/**
+ * \brief	The client ids bound to the client slots of binary frames, and the last sequence number seen per slot.
+ * \remarks	The relay binds a slot with a {"type": "client_slot", "slot": n, "client_id": "..."} text message before it sends binary frames for that client.
+ *	Not thread-safe, it is used by the connection's read handler only.
+ */
+class ClientSlotTable
+{
+	static constexpr std::size_t SlotCount{ 256 };
+	std::array<std::string, SlotCount> m_clientIds;
+	std::array<std::optional<uint16_t>, SlotCount> m_lastSequences;
+public:
+	void Bind(const uint8_t slot, const std::string_view clientId)
+	{
+		m_clientIds[slot] = clientId;
+		m_lastSequences[slot].reset();
+	}
+
+	/**
+	 * \brief	The client id bound to the slot, empty if it is unbound (or the slot is NoClientSlot).
+	 */
+	[[nodiscard]] auto GetClientId(const uint8_t slot) const noexcept -> std::optional<std::string_view>
+	{
+		if (slot == BinaryFrame::NoClientSlot || m_clientIds[slot].empty())
+			return {};
+		return m_clientIds[slot];
+	}
+
+	/**
+	 * \brief	Records the sequence number of a frame from the slot, false if it is not newer than the last one seen (a duplicate or stale frame).
+	 * \remarks	Sequence numbers wrap, a number is newer if it is less than half the range ahead of the last one.
+	 */
+	[[nodiscard]] bool AcceptSequence(const uint8_t slot, const uint16_t sequence) noexcept
+	{
+		auto& last = m_lastSequences[slot];
+		if (last && static_cast<int16_t>(static_cast<uint16_t>(sequence - *last)) <= 0)
+			return false;
+		last = sequence;
+		return true;
+	}
+
+	void Clear()
+	{
+		std::ranges::fill(m_clientIds, std::string{});
+		std::ranges::fill(m_lastSequences, std::nullopt);
+	}
+};
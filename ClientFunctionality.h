@@ -11,8 +11,18 @@
 #include <unordered_map>
 #include <array>
 #include <mutex>
+#include <algorithm>
 #include "StatConfiguration.h"
 #include "StreamToActionTranslator.h"
+#include "CommandDecoder.h"
+#include "BinaryProtocol.h"
+#include "CommandNameMap.h"
+#include "Logger.h"
+#include "ReconnectManager.h"
+#include "TlsClientContext.h"
+#include "Heartbeat.h"
+#include "InputLatency.h"
+#include "ClientMetrics.h"
 
 
 namespace asio = boost::asio;
@@ -24,35 +34,22 @@ namespace http = boost::beast::http;
 using namespace std::literals;
 
 
-// Tracks "keydown" states for command keycodes
-static const std::unordered_map<std::string, int32_t> commandLookup
+// Tracks "keydown" states for command keycodes, generated from the same list as the keycode constants.
+#define ARC_COMMAND_NAME(constant, keycode, name) CommandName{ name, constant },
+static constexpr CommandNameMap commandLookup{ std::array{ ARC_COMMAND_KEYCODES(ARC_COMMAND_NAME) } };
+#undef ARC_COMMAND_NAME
+
+// The command keycodes of commandLookup, a binary frame's command id must be one of these.
+static constexpr sds::KeySet<64> knownCommandIds = []()
 {
-	{"move_up", MouseMoveUp},
-	{"move_down", MouseMoveDown},
-	{"move_right", MouseMoveRight},
-	{"move_left", MouseMoveLeft},
-	{"move_up_left", MouseMoveUpLeft}, {"move_up_right", MouseMoveUpRight}, {"move_down_right", MouseMoveDownRight}, {"move_down_left", MouseMoveDownLeft},
-
-	{"click_left", MouseLeftClick}, {"click_right", MouseRightClick}, {"click_middle", MouseMiddleClick},
-	{"scroll_up", MouseScrollUp}, {"scroll_down", MouseScrollDown},
-	{"drag_start", MouseDragStart}, {"drag_end", MouseDragEnd},
-	//{"osk_toggle", 16},
-
-	// Multimedia controls
-	{"play_pause", MediaPlayPause},
-	{"next_track", MediaNextTrack},
-	{"previous_track", MediaPrevTrack},
-	{"volume_up", VolumeUp},
-	{"volume_down", VolumeDown},
-	{"mute_toggle", VolumeMute},
-	{"stop", MediaStop},
-	{"open_prime_video", LaunchAmazonPrime},
-	{"open_tubi", LaunchTubi},
-	{"open_netflix", LaunchNetflix},
-	{"press_escape", EscapeKey},
-	{"toggle_mouse_sensitivity", SensitivityToggle},
-	{"toggle_blue_light_filter", ToggleMonitorOverlay}
-};
+	sds::KeySet<64> ids;
+	for (const auto& entry : commandLookup.GetSlots())
+	{
+		if (!entry.Name.empty())
+			ids.Set(entry.Keycode);
+	}
+	return ids;
+}();
 
 struct ClientCallbacks
 {
@@ -60,6 +57,9 @@ struct ClientCallbacks
 	std::function<void(const std::string&)> OnError;
 	std::function<void(std::set<std::string>)> OnClientListChanged;
 	std::function<void()> OnFailure;
+	// If set, performs each transition's action (the key edges', the level update's and the release on disconnect) in place of
+	// the mapping's function, e.g. a switch on a constexpr mapping table. The translator advances the mapping state.
+	std::function<void(sds::TransitionRecord)> DispatchTransition;
 
 	template<typename Fn, typename... Args>
 	void CallOnNewThread(Fn&& fn, Args&&... args) const
@@ -78,12 +78,74 @@ struct ClientCallbacks
 
 };
 
-// Array to track 0 = up, 1 = down
-static std::array<bool, 32> keyStateBuffer{};
-static std::mutex keyStateMutex{};
+/**
+ * \brief	Performs a transition's action, with the callbacks' DispatchTransition if set, else the mapping's function, and counts it.
+ *	The one dispatch for every transition the client performs, passed to the translator's <c>Execute(pack, dispatch)</c> and <c>ProcessEdgeEvents(edges, dispatch)</c>.
+ */
+inline void PerformTransition(const sds::Translator& translator, const ClientCallbacks& callbacks, const sds::TransitionRecord record)
+{
+	GetClientMetricsInstance().RecordAction(record);
+	if (callbacks.DispatchTransition)
+		callbacks.DispatchTransition(record);
+	else
+		translator.CallMappingFunction(record);
+}
+
+// Set of command keycodes currently reported as "keydown". Updated by the read handler and read by the translator tick, both on the client's one strand.
+static sds::KeySet<64> keyStateBuffer{};
+/**
+ * \brief	A key edge, timestamped at the key-state update, and the receipt time of the frame it came from, for the latency stages.
+ */
+struct ReceivedKeyEdge
+{
+	sds::KeyEdgeEvent Edge;
+	sds::TimePoint_t ReceivedTime{};
+};
+// Every change to keyStateBuffer as a timestamped edge, in arrival order. Taken by the translator tick before each level update,
+// so that a keydown and keyup arriving within one tick are both performed.
+static std::vector<ReceivedKeyEdge> keyEdgeBuffer{};
+
+/**
+ * \brief	Analog pointer input from "move_vector" messages, coalesced until the translator tick takes it.
+ *	Displacements and scroll amounts are summed, the velocity is replaced by the latest.
+ * \remarks	Not synchronized, the read loop and the translator tick run on the client's one strand.
+ */
+struct PendingVectorInput
+{
+	double DisplacementX{};
+	double DisplacementY{};
+	double Scroll{};
+	std::optional<std::pair<double, double>> Velocity;
+
+	[[nodiscard]] bool IsEmpty() const noexcept
+	{
+		return DisplacementX == 0.0 && DisplacementY == 0.0 && Scroll == 0.0 && !Velocity;
+	}
+};
+static PendingVectorInput pendingVectorInput{};
+
+/**
+ * \brief	true if a key edge or vector input is waiting for the translator tick, the read loop then runs the tick.
+ */
+[[nodiscard]] inline bool HasPendingInput() noexcept
+{
+	return !keyEdgeBuffer.empty() || !pendingVectorInput.IsEmpty();
+}
+// A "move_vector" velocity is applied for this long, unless replaced by a newer one, so a sender that goes silent does not leave the pointer drifting.
+static constexpr sds::Nanos_t VectorVelocityTimeToLive{ std::chrono::milliseconds{ 100 } };
+// Bounds of the "move_vector" values, and of the pending sums, far beyond any real input. Larger values are clamped, so that the pointer and scroll
+// motion's whole-pixel and whole-unit conversions stay in range.
+static constexpr double MaxVectorVelocity{ 100'000.0 };
+static constexpr double MaxVectorDisplacement{ 100'000.0 };
+static constexpr double MaxVectorScroll{ 1'000.0 };
+static_assert(BinaryFrame::MaxVelocity == MaxVectorVelocity && BinaryFrame::MaxDisplacement == MaxVectorDisplacement && BinaryFrame::MaxScroll == MaxVectorScroll,
+	"Binary frames and move_vector messages have the same bounds.");
 
 std::set<std::string> connectedClientUUIDs;
-std::set<std::string> trustedClientUUIDs;
+// Transparent comparison, so a client_id can be checked without copying it out of the received frame.
+std::set<std::string, std::less<>> trustedClientUUIDs;
+// Client ids of the binary frame client slots, bound by "client_slot" messages from the relay. Cleared on (re)connect.
+static ClientSlotTable clientSlots{};
 
 void HandleWebClientListUpdate(const nlohmann::json& json, const ClientCallbacks& callbacks) {
 	connectedClientUUIDs.clear();
@@ -100,223 +162,780 @@ void HandleWebClientListUpdate(const nlohmann::json& json, const ClientCallbacks
 	}
 }
 
-void UpdateStateBuffer(const std::string state, const std::string command)
+/**
+ * \brief	Sets the key state, and records the change for the translator tick.
+ */
+void UpdateKeyState(const int32_t keycode, const bool isDown, const sds::TimePoint_t receivedTime)
 {
-	std::lock_guard lock(keyStateMutex);
+	GetClientMetricsInstance().RecordCommand(keycode, isDown);
+	const bool didChange = isDown
+		? keyStateBuffer.Set(keycode)
+		: keyStateBuffer.Reset(keycode);
+	if (!didChange)
+		return;
+	const auto now = sds::Clock_t::now();
+	GetInputLatencyInstance().Record(LatencyStage::Decode, now - receivedTime);
+	keyEdgeBuffer.push_back({ .Edge = { .VirtualKeycode = keycode, .IsDown = isDown, .Time = now }, .ReceivedTime = receivedTime });
+}
 
-	const auto result = commandLookup.find(command);
-	if (result != commandLookup.cend())
-	{
-		keyStateBuffer[result->second] = state == "keydown";
-	}
+void UpdateStateBuffer(const std::string_view state, const std::string_view command, const sds::TimePoint_t receivedTime)
+{
+	if (const auto keycode = commandLookup.Find(command))
+		UpdateKeyState(*keycode, state == "keydown", receivedTime);
 }
 
-void ReadMessage(auto& ws, beast::flat_buffer& buffer, std::atomic<bool>& stop_signal, const ClientCallbacks& callbacks)
+/**
+ * \brief	The system clock's time at a frame's receipt, to compare with the sender's timestamp.
+ */
+auto GetSystemReceivedTime(const sds::TimePoint_t receivedTime) -> std::chrono::system_clock::time_point
 {
-	ws.async_read(buffer, [&](boost::system::error_code ec, std::size_t bytes_transferred) {
-		if (ec == websocket::error::closed) {
-			std::cout << "[Desktop Client] Disconnected normally.\n";
-			stop_signal.store(true);
-			return;
+	return std::chrono::system_clock::now() - std::chrono::duration_cast<std::chrono::system_clock::duration>(sds::Clock_t::now() - receivedTime);
+}
+
+/**
+ * \brief	Records the network leg of a frame, from the sender's timestamp to the frame's receipt. The sender's clock is taken to be synchronized
+ *	with this one, a leg that comes out negative (the sender's clock is ahead) is not recorded.
+ */
+void RecordNetworkLatency(const std::chrono::nanoseconds networkLeg)
+{
+	if (networkLeg >= std::chrono::nanoseconds{})
+		GetInputLatencyInstance().Record(LatencyStage::Network, networkLeg);
+}
+
+/**
+ * \brief	Handles a "move_vector" message: "vx"/"vy" velocity in pixels per second, and/or "dx"/"dy" displacement in pixels (screen coordinates, Y down),
+ *	and/or "scroll" in wheel notches (positive is away from the user). The values, and the pending sums, are clamped to the MaxVector* bounds.
+ * \remarks	Messages are merged into the pending input until the translator tick takes it.
+ */
+void UpdateVectorInput(const std::optional<std::pair<double, double>> velocity, const double dx, const double dy, const double scroll)
+{
+	if (velocity)
+		pendingVectorInput.Velocity = std::make_pair(std::clamp(velocity->first, -MaxVectorVelocity, MaxVectorVelocity), std::clamp(velocity->second, -MaxVectorVelocity, MaxVectorVelocity));
+	pendingVectorInput.DisplacementX = std::clamp(pendingVectorInput.DisplacementX + dx, -MaxVectorDisplacement, MaxVectorDisplacement);
+	pendingVectorInput.DisplacementY = std::clamp(pendingVectorInput.DisplacementY + dy, -MaxVectorDisplacement, MaxVectorDisplacement);
+	pendingVectorInput.Scroll = std::clamp(pendingVectorInput.Scroll + scroll, -MaxVectorScroll, MaxVectorScroll);
+}
+
+void UpdateVectorInput(const nlohmann::json& json)
+{
+	const auto velocity = json.contains("vx") || json.contains("vy")
+		? std::make_optional(std::make_pair(json.value("vx", 0.0), json.value("vy", 0.0)))
+		: std::nullopt;
+	UpdateVectorInput(velocity, json.value("dx", 0.0), json.value("dy", 0.0), json.value("scroll", 0.0));
+}
+
+/**
+ * \brief	Handles a {"command", "state", "client_id"} message, the command is ignored if the client is not trusted.
+ */
+void HandleCommandMessage(const CommandMessage& message, const sds::TimePoint_t receivedTime, const ClientCallbacks& callbacks)
+{
+	if (message.ClientId && !trustedClientUUIDs.contains(*message.ClientId)) {
+		GetClientMetricsInstance().RecordRejected(RejectReason::Untrusted);
+		if (callbacks.OnError) {
+			callbacks.OnError("[Security] Ignoring command from untrusted client: "s + std::string{ *message.ClientId } + "\n"s);
 		}
+		return;
+	}
 
-		if (ec) {
-			const std::string errMsg = "[ERROR] Desktop Client Read Error: "s + ec.message() + "\n"s;
-			std::cerr << errMsg;
-			if (callbacks.OnError)
-				callbacks.OnError(errMsg);
+	LogDebug("[Desktop Client] Received Command: {} | State: {}", message.Command, message.State);
+
+	if (message.SentTime)
+		RecordNetworkLatency(GetSystemReceivedTime(receivedTime) - std::chrono::system_clock::time_point{ std::chrono::milliseconds{ *message.SentTime } });
+	UpdateStateBuffer(message.State, message.Command, receivedTime);
+}
 
-			stop_signal.store(true);
+/**
+ * \brief	Handles a binary frame, the counterpart of the JSON command and "move_vector" messages. Ignored if the client slot is bound to a client
+ *	that is not trusted, or if the frame is not newer than the last one from its slot.
+ */
+void HandleBinaryFrame(const std::span<const uint8_t> bytes, const sds::TimePoint_t receivedTime, const ClientCallbacks& callbacks)
+{
+	auto& metrics = GetClientMetricsInstance();
+	const auto frame = DecodeBinaryFrame(bytes);
+	if (!frame) {
+		metrics.RecordRejected(RejectReason::Malformed);
+		LogError("[ERROR] Malformed binary frame of {} bytes.", bytes.size());
+		if (callbacks.OnError)
+			callbacks.OnError("[ERROR] Malformed binary frame of "s + std::to_string(bytes.size()) + " bytes.\n"s);
+		return;
+	}
+	metrics.RecordParsed();
+
+	if (frame->ClientSlot != BinaryFrame::NoClientSlot) {
+		const auto clientId = clientSlots.GetClientId(frame->ClientSlot);
+		if (!clientId || !trustedClientUUIDs.contains(*clientId)) {
+			metrics.RecordRejected(RejectReason::Untrusted);
+			if (callbacks.OnError) {
+				callbacks.OnError("[Security] Ignoring binary frame from untrusted client slot: "s + std::to_string(frame->ClientSlot) + "\n"s);
+			}
 			return;
 		}
+	}
+	if (!clientSlots.AcceptSequence(frame->ClientSlot, frame->Sequence)) {
+		metrics.RecordRejected(RejectReason::Stale);
+		return;
+	}
 
-		const std::string payload = beast::buffers_to_string(buffer.data());
-		buffer.consume(bytes_transferred);
+	if (frame->Has(BinaryFrameFlags::HasTimestamp)) {
+		// The timestamp is the low 32 bits of the sender's Unix time in microseconds, the difference wraps the same way.
+		const auto receivedMicros = std::chrono::duration_cast<std::chrono::microseconds>(GetSystemReceivedTime(receivedTime).time_since_epoch());
+		RecordNetworkLatency(std::chrono::microseconds{ static_cast<int32_t>(static_cast<uint32_t>(receivedMicros.count()) - frame->Timestamp) });
+	}
 
-		try {
-			const auto json = nlohmann::json::parse(payload);
+	if (frame->Has(BinaryFrameFlags::HasCommand) && knownCommandIds.Contains(frame->CommandId)) {
+		const bool isDown = frame->Has(BinaryFrameFlags::IsDown);
+		LogDebug("[Desktop Client] Received Command: {} | State: {}", frame->CommandId, isDown ? "keydown" : "keyup");
 
-			bool handled = false;
+		UpdateKeyState(frame->CommandId, isDown, receivedTime);
+	}
 
-			if (json.contains("type") && json["type"] == "web_client_list") {
-				HandleWebClientListUpdate(json, callbacks);
-				handled = true;
-			}
+	if (frame->Has(BinaryFrameFlags::HasVelocity) || frame->Has(BinaryFrameFlags::HasDisplacement) || frame->Has(BinaryFrameFlags::HasScroll)) {
+		const auto velocity = frame->Has(BinaryFrameFlags::HasVelocity)
+			? std::make_optional(std::pair<double, double>{ frame->VelocityX, frame->VelocityY })
+			: std::nullopt;
+		UpdateVectorInput(velocity, frame->DisplacementX, frame->DisplacementY, frame->Scroll);
+	}
+}
 
-			if (json.contains("command") && json.contains("state")) {
-				const std::string command = json["command"];
-				const std::string state = json["state"];
-
-				if (json.contains("client_id")) {
-					const std::string& uuid = json["client_id"];
-					if (!trustedClientUUIDs.contains(uuid)) {
-						if (callbacks.OnError) {
-							callbacks.OnError("[Security] Ignoring command from untrusted client: "s + uuid + "\n"s);
-						}
-						handled = true;
-					}
-				}
+/**
+ * \brief	Handles a text frame, the command message or one of the JSON messages of the relay.
+ */
+void HandleTextFrame(const std::string_view payload, const sds::TimePoint_t receivedTime, const ClientCallbacks& callbacks)
+{
+	// Nearly all traffic is the plain command message, which is decoded without building a DOM, everything else takes the full parse.
+	if (const auto message = DecodeCommandMessage(payload)) {
+		GetClientMetricsInstance().RecordParsed();
+		HandleCommandMessage(*message, receivedTime, callbacks);
+		return;
+	}
+
+	try {
+		const auto json = nlohmann::json::parse(payload);
+
+		bool handled = false;
+
+		if (json.contains("type") && json["type"] == "web_client_list") {
+			HandleWebClientListUpdate(json, callbacks);
+			handled = true;
+		}
 
-				if (!handled) {
-					std::cout << "[Desktop Client] Received Command: " << command
-						<< " | State: " << state << "\n";
+		if (json.contains("type") && json["type"] == "client_slot") {
+			// at(...), a missing field throws (operator[] of a const json does not check), the message is then rejected as malformed.
+			const auto slot = json.at("slot").get<int>();
+			const auto& clientId = json.at("client_id").get_ref<const std::string&>();
+			if (slot >= 0 && slot < BinaryFrame::NoClientSlot)
+				clientSlots.Bind(static_cast<uint8_t>(slot), clientId);
+			handled = true;
+		}
 
-					UpdateStateBuffer(state, command);
+		if (json.contains("type") && json["type"] == "move_vector") {
+			if (json.contains("client_id") && !trustedClientUUIDs.contains(json["client_id"].get<std::string>())) {
+				GetClientMetricsInstance().RecordRejected(RejectReason::Untrusted);
+				if (callbacks.OnError) {
+					callbacks.OnError("[Security] Ignoring move_vector from untrusted client: "s + json["client_id"].get<std::string>() + "\n"s);
 				}
 			}
+			else {
+				UpdateVectorInput(json);
+			}
+			handled = true;
+		}
+
+		if (!handled && json.contains("command") && json.contains("state")) {
+			HandleCommandMessage(CommandMessage
+				{
+					.Command = json["command"].get_ref<const std::string&>(),
+					.State = json["state"].get_ref<const std::string&>(),
+					.ClientId = json.contains("client_id") ? std::make_optional<std::string_view>(json["client_id"].get_ref<const std::string&>()) : std::nullopt,
+					.SentTime = json.contains("sent_at") && json["sent_at"].is_number_unsigned() ? std::make_optional(json["sent_at"].get<uint64_t>()) : std::nullopt
+				}, receivedTime, callbacks);
+		}
+		GetClientMetricsInstance().RecordParsed();
+	}
+	catch (const nlohmann::json::exception& e) {
+		// Parse errors, and type errors from fields of the wrong type.
+		GetClientMetricsInstance().RecordRejected(RejectReason::Malformed);
+		const std::string errMsg = "[ERROR] JSON error: "s + e.what() + "\n"s;
+		LogError("[ERROR] JSON error: {}", e.what());
+		if (callbacks.OnError)
+			callbacks.OnError(errMsg);
+	}
+}
+
+/**
+ * \brief	Wakes the running client from another thread when a stop is requested, so that nothing polls the stop flag.
+ */
+class ClientStopNotifier
+{
+	std::mutex m_mutex;
+	std::function<void()> m_onStop;
+public:
+	/**
+	 * \brief	Registers the function that stops the running client, for the lifetime of the Registration.
+	 */
+	class [[nodiscard]] Registration
+	{
+		ClientStopNotifier& m_notifier;
+	public:
+		Registration(ClientStopNotifier& notifier, std::function<void()> onStop) : m_notifier(notifier)
+		{
+			std::lock_guard lock(m_notifier.m_mutex);
+			m_notifier.m_onStop = std::move(onStop);
+		}
+		Registration(const Registration&) = delete;
+		auto operator=(const Registration&) -> Registration & = delete;
+		~Registration()
+		{
+			std::lock_guard lock(m_notifier.m_mutex);
+			m_notifier.m_onStop = {};
+		}
+	};
+
+	/**
+	 * \brief	Called after setting the stop flag, stops the running client (if any).
+	 */
+	void Notify()
+	{
+		std::lock_guard lock(m_mutex);
+		if (m_onStop)
+			m_onStop();
+	}
+};
+
+// get global client stop notifier instance
+inline ClientStopNotifier& GetClientStopNotifierInstance()
+{
+	static ClientStopNotifier instance;
+	return instance;
+}
+
+/**
+ * \brief	One connection, the stream and timers shared by its coroutines. They all run on the strand, on the one thread running the io_context,
+ *	so the stream is never used from another thread.
+ * \remarks	The translator tick runs on the same thread, from the read loop right after a message that changed the key state or vector input
+ *	(no other thread has to be woken), and from RunTranslatorTicks(...) at the translator's next deadline.
+ */
+struct ClientSession
+{
+	asio::strand<asio::io_context::executor_type> Strand;
+	TlsClientContext& Tls;
+	tcp::resolver Resolver;
+	std::shared_ptr<HappyEyeballsConnector> Connector;
+	// tcp_stream for the expiry of the TLS handshake, the websocket stream's own timeouts apply after it.
+	websocket::stream<beast::ssl_stream<beast::tcp_stream>> Stream;
+	Heartbeat Pings;
+	asio::steady_timer PingTimer;
+	// Expires at the earliest repeat/reset/motion output deadline, or never if nothing is waiting on a timer.
+	asio::steady_timer TickTimer;
+	beast::flat_buffer Buffer;
+	bool IsOpen{};
+	bool IsStopping{};
+	// Closed by the heartbeat, the server stopped answering pings.
+	bool IsDead{};
+private:
+	std::shared_ptr<sds::Translator> m_translator;
+	const ClientCallbacks& m_callbacks;
+	// Taken from keyEdgeBuffer each tick, cleared rather than released so it keeps its capacity.
+	std::vector<sds::KeyEdgeEvent> m_edges;
+	// The receipt time of the frame of each of m_edges.
+	std::vector<sds::TimePoint_t> m_edgeReceivedTimes;
+	// Re-used every update so that a steady-state tick does not allocate.
+	sds::TransitionPack m_transitions;
+public:
+	ClientSession(const asio::strand<asio::io_context::executor_type>& strand, TlsClientContext& tls, const HeartbeatPolicy& heartbeatPolicy,
+		std::shared_ptr<sds::Translator> translatorPtr, const ClientCallbacks& callbacks)
+		: Strand(strand), Tls(tls), Resolver(Strand), Connector(std::make_shared<HappyEyeballsConnector>(Strand)), Stream(Strand, Tls.GetContext()),
+		Pings(heartbeatPolicy), PingTimer(Strand), TickTimer(Strand),
+		m_translator(std::move(translatorPtr)), m_callbacks(callbacks),
+		m_transitions(m_translator ? m_translator->MakeTransitionPack() : sds::TransitionPack{}) { }
+
+	/**
+	 * \brief	Runs a translator tick if the key state or vector input changed since the last one.
+	 */
+	void TickTranslatorIfChanged()
+	{
+		if (HasPendingInput())
+			TickTranslator();
+	}
+
+	/**
+	 * \brief	Performs the key-state changes and vector input since the last tick, and the timed (repeat, reset, motion) actions that are due,
+	 *	then sets TickTimer to the next deadline.
+	 */
+	void TickTranslator()
+	{
+		for (const auto& edge : keyEdgeBuffer)
+		{
+			m_edges.push_back(edge.Edge);
+			m_edgeReceivedTimes.push_back(edge.ReceivedTime);
+		}
+		keyEdgeBuffer.clear();
+		const auto heldDownKeys = keyStateBuffer;
+		const auto vectorInput = std::exchange(pendingVectorInput, {});
+		// One clock read per tick, shared by the pointer motion and every mapping's timer checks and resets.
+		const auto now = sds::Clock_t::now();
+		auto& metrics = GetClientMetricsInstance();
+		auto& pointerMotion = GetPointerMotionInstance();
+		// Motion up to now is integrated with the directions and velocity held until now, before this tick's input changes them.
+		pointerMotion.AddDisplacement(vectorInput.DisplacementX, vectorInput.DisplacementY);
+		pointerMotion.Update(now, GetInputSinkInstance(), GetSensitivityTogglerInstance().Get());
+		auto& scrollMotion = GetScrollMotionInstance();
+		scrollMotion.AddScroll(vectorInput.Scroll);
+		scrollMotion.Update(now, GetInputSinkInstance());
+		if (vectorInput.Velocity)
+			pointerMotion.SetVelocity(vectorInput.Velocity->first, vectorInput.Velocity->second, now + VectorVelocityTimeToLive);
+		std::optional<sds::TimePoint_t> nextDeadline;
+		if (m_translator)
+		{
+			const auto dispatch = [this](const sds::TransitionRecord record) { PerformTransition(*m_translator, m_callbacks, record); };
+			// Edges first, each performed exactly once in order, then the level update continues from the resulting states (repeats, resets).
+			m_translator->ProcessEdgeEvents(m_edges, dispatch);
+			m_translator->GetUpdatedTransitions(heldDownKeys, m_transitions, now);
+			m_translator->Execute(m_transitions, dispatch, now);
+			nextDeadline = m_translator->GetNextDeadline();
+		}
+		// Everything the tick's actions injected, in one submission.
+		GetInputSinkInstance().Flush();
+		const auto performedTime = sds::Clock_t::now();
+		metrics.TickDuration.Record(performedTime - now);
+		RecordEdgeLatencies(now, performedTime);
+		for (const auto motionDeadline : { pointerMotion.GetNextDeadline(), scrollMotion.GetNextDeadline() })
+		{
+			if (motionDeadline && (!nextDeadline || *motionDeadline < *nextDeadline))
+				nextDeadline = motionDeadline;
+		}
+
+		// Re-arming the timer cancels the pending wait, RunTranslatorTicks(...) then waits for the new expiry.
+		TickTimer.expires_at(nextDeadline
+			? std::chrono::time_point_cast<asio::steady_timer::duration>(*nextDeadline)
+			: asio::steady_timer::time_point::max());
+	}
+
+	/**
+	 * \brief	Records the latency stages of the tick's edges, picked up at 'pickupTime', their actions performed and flushed at 'performedTime'.
+	 */
+	void RecordEdgeLatencies(const sds::TimePoint_t pickupTime, const sds::TimePoint_t performedTime)
+	{
+		if (m_edges.empty())
+			return;
+		auto& latency = GetInputLatencyInstance();
+		for (std::size_t i{}; i < m_edges.size(); ++i)
+		{
+			latency.Record(LatencyStage::Queue, pickupTime - m_edges[i].Time);
+			latency.Record(LatencyStage::Action, performedTime - pickupTime);
+			latency.Record(LatencyStage::Total, performedTime - m_edgeReceivedTimes[i]);
+		}
+		m_edges.clear();
+		m_edgeReceivedTimes.clear();
+	}
+
+	/**
+	 * \brief	Closes the connection without a close handshake, the server has stopped answering. The read loop then ends, and the client reconnects.
+	 */
+	void CloseDeadConnection()
+	{
+		IsDead = true;
+		GetHeartbeatMetricsInstance().DeadConnections.fetch_add(1, std::memory_order_relaxed);
+		LogWarn("[Heartbeat] No pong for {} pings, closing the connection.", Pings.GetMissedPongs());
+		beast::get_lowest_layer(Stream).close();
+	}
+
+	/**
+	 * \brief	Ends the ping and translator tick coroutines.
+	 */
+	void StopTimers()
+	{
+		IsStopping = true;
+		PingTimer.cancel();
+		TickTimer.cancel();
+	}
+};
+
+// Completion of a client coroutine, an exception is rethrown from io_context::run(), to the retry loop.
+inline void RethrowOnError(const std::exception_ptr& e)
+{
+	if (e)
+		std::rethrow_exception(e);
+}
+
+/**
+ * \brief	Handles the frames received until the connection is closed or fails.
+ */
+auto ReadMessages(const std::shared_ptr<ClientSession> session, const ClientCallbacks& callbacks) -> asio::awaitable<void>
+{
+	auto& ws = session->Stream;
+	auto& buffer = session->Buffer;
+	while (true)
+	{
+		boost::system::error_code ec;
+		const auto bytes_transferred = co_await ws.async_read(buffer, asio::redirect_error(asio::use_awaitable, ec));
+		if (ec == websocket::error::closed) {
+			LogInfo("[Desktop Client] Disconnected normally.");
+			co_return;
 		}
-		catch (const nlohmann::json::parse_error& e) {
-			const std::string errMsg = "[ERROR] JSON parse error: "s + e.what() + "\n"s;
-			std::cerr << errMsg;
+
+		if (ec) {
+			// Aborted by the stop, not an error.
+			if (session->IsStopping)
+				co_return;
+			const auto reason = session->IsDead ? "no pong received"s : ec.message();
+			const std::string errMsg = "[ERROR] Desktop Client Read Error: "s + reason + "\n"s;
+			LogError("[ERROR] Desktop Client Read Error: {}", reason);
 			if (callbacks.OnError)
 				callbacks.OnError(errMsg);
+			co_return;
 		}
 
-		// The next read
-		ReadMessage(ws, buffer, stop_signal, callbacks);
+		const auto receivedTime = sds::Clock_t::now();
+		GetClientMetricsInstance().RecordReceived(ws.got_binary() ? FrameFormat::Binary : FrameFormat::Text);
+		// The frame is read in place, and consumed from the buffer once handled.
+		// Binary frames are only sent by a relay that accepted the binary format offered at registration.
+		if (ws.got_binary())
+			HandleBinaryFrame({ static_cast<const uint8_t*>(buffer.data().data()), bytes_transferred }, receivedTime, callbacks);
+		else
+			HandleTextFrame({ static_cast<const char*>(buffer.data().data()), bytes_transferred }, receivedTime, callbacks);
+		buffer.consume(bytes_transferred);
+
+		session->TickTranslatorIfChanged();
+	}
+}
+
+/**
+ * \brief	Sends a ping at once, then every HeartbeatPolicy::Interval, and closes the connection once too many pongs in a row are missed.
+ *	The pongs are timed by the stream's control callback, as the read loop receives them.
+ */
+auto RunHeartbeat(const std::shared_ptr<ClientSession> session) -> asio::awaitable<void>
+{
+	auto& heartbeat = session->Pings;
+	session->Stream.control_callback([&heartbeat](const websocket::frame_type kind, const beast::string_view payload)
+		{
+			if (kind == websocket::frame_type::pong)
+				heartbeat.OnPong({ payload.data(), payload.size() }, std::chrono::steady_clock::now());
 		});
+
+	while (!session->IsStopping)
+	{
+		const auto ping = heartbeat.MakePing(std::chrono::steady_clock::now());
+		if (heartbeat.IsDead()) {
+			session->CloseDeadConnection();
+			co_return;
+		}
+
+		boost::system::error_code ec;
+		co_await session->Stream.async_ping(ping, asio::redirect_error(asio::use_awaitable, ec));
+		if (ec) {
+			LogWarn("[WARN] WebSocket ping failed: {}", ec.message());
+		}
+		else {
+			LogDebug("[KeepAlive] Sent ping");
+		}
+
+		session->PingTimer.expires_after(heartbeat.GetPolicy().Interval);
+		co_await session->PingTimer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+	}
 }
 
-void WebSocketClient(
+/**
+ * \brief	Runs the translator ticks that are due on a timer, the first one at once.
+ */
+auto RunTranslatorTicks(const std::shared_ptr<ClientSession> session) -> asio::awaitable<void>
+{
+	session->TickTranslator();
+	while (!session->IsStopping) {
+		boost::system::error_code ec;
+		co_await session->TickTimer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+		// Aborted when a tick from the read loop re-armed the timer, or by the stop.
+		if (!session->IsStopping && ec != asio::error::operation_aborted)
+			session->TickTranslator();
+	}
+}
+
+/**
+ * \brief	Ends the session, the read loop ends when the close handshake completes (or, while still connecting, the connect phase fails).
+ */
+auto CloseSession(const std::shared_ptr<ClientSession> session, const std::string& client_type) -> asio::awaitable<void>
+{
+	if (session->IsStopping)
+		co_return;
+	session->StopTimers();
+
+	boost::system::error_code ec;
+	if (!session->IsOpen) {
+		session->Resolver.cancel();
+		session->Connector->Cancel();
+		beast::get_lowest_layer(session->Stream).close();
+		co_return;
+	}
+
+	co_await session->Stream.async_close(websocket::close_code::normal, asio::redirect_error(asio::use_awaitable, ec));
+	if (ec &&
+		ec != boost::asio::error::eof &&
+		ec != boost::asio::ssl::error::stream_truncated &&
+		ec.category() != boost::asio::error::get_ssl_category()) // Optional filter
+	{
+		LogWarn("[WARN] WebSocket close error: {}", ec.message());
+	}
+	else
+	{
+		LogInfo("[{} Client] Connection closed gracefully.", client_type);
+	}
+}
+
+/**
+ * \brief	Connects, registers, and runs the connection until it is closed or fails. Throws if the connect fails.
+ * \remarks	Each connect phase has its own time limit: the resolve (falling back to the cached endpoints), the happy eyeballs connect,
+ *	and the TLS and WebSocket handshakes.
+ */
+auto RunClientSession(
+	const std::shared_ptr<ClientSession> session,
 	const std::string& host,
 	const std::string& port,
 	const std::string& session_token,
 	const std::string& client_type,
-	std::atomic<bool>& should_stop,
 	const ClientCallbacks& callbacks,
-	std::shared_ptr<sds::Translator> translatorPtr
-)
+	ReconnectManager& reconnect
+) -> asio::awaitable<void>
 {
-	constexpr int max_retries = 5;
-	constexpr int reconnect_delay_ms = 1000; // Delay between reconnects
-	constexpr std::chrono::seconds ping_interval{ 50 };
-	int retry_count = 0;
+	const auto& policy = reconnect.GetPolicy();
+	auto& ws = session->Stream;
+	auto& endpointCache = GetEndpointCacheInstance();
+	const auto endpoints = co_await ResolveEndpoints(session->Resolver, host, port, endpointCache, policy);
+	if (session->IsStopping)
+		co_return;
+	try {
+		beast::get_lowest_layer(ws).socket() = co_await session->Connector->Connect(endpoints, policy.ConnectionAttemptDelay, policy.ConnectTimeout);
+	}
+	catch (const boost::system::system_error&) {
+		// None of the endpoints connected, they may have changed.
+		endpointCache.Invalidate();
+		throw;
+	}
+	// Without Nagle's algorithm, a ping sent right after the registration is not held until the registration is acknowledged.
+	beast::get_lowest_layer(ws).socket().set_option(tcp::no_delay(true));
+
+	// Resumes the session of the previous connection, if the server still accepts it.
+	session->Tls.PrepareHandshake(ws.next_layer().native_handle(), host);
+	const auto handshakeStart = std::chrono::steady_clock::now();
+	beast::get_lowest_layer(ws).expires_after(policy.TlsHandshakeTimeout);
+	co_await ws.next_layer().async_handshake(ssl::stream_base::client, asio::use_awaitable);
+	beast::get_lowest_layer(ws).expires_never();
+	session->Tls.OnHandshakeCompleted(ws.next_layer().native_handle(), std::chrono::steady_clock::now() - handshakeStart);
+
+	auto timeouts = websocket::stream_base::timeout::suggested(beast::role_type::client);
+	timeouts.handshake_timeout = policy.WebSocketHandshakeTimeout;
+	ws.set_option(timeouts);
+	ws.set_option(websocket::stream_base::decorator(
+		[](websocket::request_type& req) {
+			req.set(http::field::user_agent, std::string("ARC Desktop Client"));
+		}
+	));
+	co_await ws.async_handshake(host, "/ws/", asio::use_awaitable);
+
+	// The binary frame format is offered, the relay may use it or keep to JSON, which is always accepted.
+	nlohmann::json register_msg = {
+		{"session_token", session_token},
+		{"client_type", client_type},
+		{"frame_formats", {BinaryProtocolName, "json"}}
+	};
+	clientSlots.Clear();
+	const auto registration = register_msg.dump();
+	co_await ws.async_write(asio::buffer(registration), asio::use_awaitable);
+	session->IsOpen = true;
+	if (session->IsStopping)
+		co_return;
+
+	reconnect.OnConnected();
+	LogInfo("[{} Client] Connected with session: {}", client_type, session_token);
+	if (callbacks.OnConnect)
+	{
+		callbacks.OnConnect();
+	}
 
-	while (max_retries < 0 || retry_count < max_retries) 
+	asio::co_spawn(session->Strand, RunHeartbeat(session), RethrowOnError);
+	asio::co_spawn(session->Strand, RunTranslatorTicks(session), RethrowOnError);
+	co_await ReadMessages(session, callbacks);
+	session->StopTimers();
+}
+
+/**
+ * \brief	Releases every held key and drops the pending input, when a connection ends, so nothing stays held down until the next one.
+ */
+void ReleaseHeldInput(const std::shared_ptr<sds::Translator>& translatorPtr, const ClientCallbacks& callbacks)
+{
+	keyStateBuffer.Clear();
+	keyEdgeBuffer.clear();
+	pendingVectorInput = {};
+	// Integrate the motion up to now first, the released directions then stop it from now rather than from the last tick.
+	const auto now = sds::Clock_t::now();
+	GetPointerMotionInstance().Update(now, GetInputSinkInstance(), GetSensitivityTogglerInstance().Get());
+	GetScrollMotionInstance().Update(now, GetInputSinkInstance());
+	if (translatorPtr)
 	{
-		try {
-			asio::io_context ioc;
-			auto work_guard = asio::make_work_guard(ioc);
-
-			ssl::context ctx(ssl::context::tlsv12_client);
-			ctx.set_verify_mode(ssl::verify_none);  // Accept self-signed certs
-
-			tcp::resolver resolver(ioc);
-			websocket::stream<beast::ssl_stream<tcp::socket>> ws(ioc, ctx);
-			ws.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
-			ws.set_option(websocket::stream_base::decorator(
-				[](websocket::request_type& req) {
-					req.set(http::field::user_agent, std::string("ARC Desktop Client"));
-				}
-			));
+		// The same dispatch as the translator tick's.
+		for (const auto record : translatorPtr->GetCleanupTransitions())
+		{
+			PerformTransition(*translatorPtr, callbacks, record);
+			translatorPtr->AdvanceState(record, now);
+		}
+	}
+	GetInputSinkInstance().Flush();
+}
 
-			//std::atomic<bool> stop_signal{ false };
+/**
+ * \brief	The client's one connection at a time, and the wait between them. Used on the strand only.
+ */
+struct ClientRunState
+{
+	asio::strand<asio::io_context::executor_type> Strand;
+	asio::steady_timer BackoffTimer;
+	asio::steady_timer LatencyReportTimer;
+	std::shared_ptr<ClientSession> Session;
+	bool IsStopping{};
+	bool HasGivenUp{};
+
+	explicit ClientRunState(asio::io_context& ioc) : Strand(asio::make_strand(ioc)), BackoffTimer(Strand), LatencyReportTimer(Strand) { }
+};
 
-			const auto results = resolver.resolve(host, port);
-			asio::connect(ws.next_layer().next_layer(), results.begin(), results.end());
-			ws.next_layer().handshake(ssl::stream_base::client);
-			ws.handshake(host, "/ws/");
+/**
+ * \brief	Stops the client, from the strand, ending the backoff wait or the current session.
+ */
+auto StopClientRun(const std::shared_ptr<ClientRunState> run, const std::string& client_type) -> asio::awaitable<void>
+{
+	run->IsStopping = true;
+	run->BackoffTimer.cancel();
+	run->LatencyReportTimer.cancel();
+	if (run->Session)
+		co_await CloseSession(run->Session, client_type);
+}
 
-			nlohmann::json register_msg = {
-				{"session_token", session_token},
-				{"client_type", client_type}
-			};
-			ws.write(asio::buffer(register_msg.dump()));
+/**
+ * \brief	Writes the input latency report to the log every interval that had new samples, until the client stops or gives up.
+ */
+auto RunLatencyReports(const std::shared_ptr<ClientRunState> run, const std::chrono::seconds interval) -> asio::awaitable<void>
+{
+	while (!run->IsStopping && !run->HasGivenUp)
+	{
+		boost::system::error_code ec;
+		run->LatencyReportTimer.expires_after(interval);
+		co_await run->LatencyReportTimer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+		if (!run->IsStopping && !run->HasGivenUp)
+			GetInputLatencyInstance().DumpIfChanged();
+	}
+}
 
-			std::cout << "[" << client_type << " Client] Connected with session: " << session_token << "\n";
-			if (callbacks.OnConnect)
-			{
-				callbacks.OnConnect();
+/**
+ * \brief	Connects, and reconnects whenever the connection is lost or an attempt fails, until stopped (or ReconnectPolicy::MaxAttempts
+ *	consecutive failures). The first retry after a lost connection is immediate, later ones back off.
+ */
+auto RunClient(
+	const std::shared_ptr<ClientRunState> run,
+	TlsClientContext& tls,
+	const std::string& host,
+	const std::string& port,
+	const std::string& session_token,
+	const std::string& client_type,
+	const ClientCallbacks& callbacks,
+	const std::shared_ptr<sds::Translator> translatorPtr,
+	ReconnectManager& reconnect,
+	const HeartbeatPolicy& heartbeatPolicy
+) -> asio::awaitable<void>
+{
+	while (!run->IsStopping)
+	{
+		run->Session = std::make_shared<ClientSession>(run->Strand, tls, heartbeatPolicy, translatorPtr, callbacks);
+		std::string errMsg;
+		try {
+			co_await RunClientSession(run->Session, host, port, session_token, client_type, callbacks, reconnect);
+		}
+		catch (const std::exception& e) {
+			errMsg = e.what();
+		}
+		const bool wasConnected = run->Session->IsOpen;
+		run->Session.reset();
+		ReleaseHeldInput(translatorPtr, callbacks);
+		if (run->IsStopping)
+			break;
+
+		if (!errMsg.empty()) {
+			LogError("[ERROR] {} Client Error: {}", client_type, errMsg);
+			// Once per outage, not for every retry.
+			if (callbacks.OnError && reconnect.GetFailedAttempts() == 0) {
+				callbacks.OnError(errMsg);
 			}
+		}
 
-			beast::flat_buffer buffer;
-			ReadMessage(ws, buffer, should_stop, callbacks);
-
-			std::thread translator_thread([&]() {
-				while (!should_stop.load()) {
-					sds::SmallVector_t<int32_t> heldDownKeys;
-					{
-						std::lock_guard lock(keyStateMutex);
-						for (size_t i = 0; i < keyStateBuffer.size(); ++i) {
-							if (keyStateBuffer[i])
-								heldDownKeys.push_back(static_cast<int32_t>(i));
-						}
-					}
-					if(translatorPtr)
-						translatorPtr->GetUpdatedState(heldDownKeys)();
-
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				}
-				});
-
-			std::thread asio_thread([&]() { ioc.run(); });
-
-			auto last_ping_time = std::chrono::steady_clock::now();
-			while (!should_stop.load()) {
-				if (std::chrono::steady_clock::now() - last_ping_time > ping_interval) {
-					boost::system::error_code ec;
-					ws.ping({}, ec);
-					if (ec) {
-						std::cerr << "[WARN] WebSocket ping failed: " << ec.message() << "\n";
-					}
-					else {
-						std::cout << "[KeepAlive] Sent ping\n";
-					}
-					last_ping_time = std::chrono::steady_clock::now();
-				}
+		const auto delay = reconnect.OnDisconnected(wasConnected);
+		if (!delay) {
+			LogError("[ERROR] {} Client gave up after {} failed attempts.", client_type, reconnect.GetFailedAttempts());
+			run->HasGivenUp = true;
+			run->LatencyReportTimer.cancel();
+			break;
+		}
+		if (*delay > std::chrono::milliseconds{}) {
+			LogInfo("[INFO] Attempting to reconnect in {}ms...", delay->count());
+			boost::system::error_code ec;
+			run->BackoffTimer.expires_after(*delay);
+			co_await run->BackoffTimer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+		}
+	}
+}
 
-				std::this_thread::sleep_for(std::chrono::milliseconds(500));
-			}
-			should_stop.store(true);
-			work_guard.reset();  // Allow io_context to stop
-			ioc.stop();          // Actually cause .run() to exit
-			asio_thread.join();
-			translator_thread.join();
+/**
+ * \brief	Runs the client until it is stopped (or gives up, see ReconnectPolicy::MaxAttempts, then OnFailure is called).
+ * \remarks	The client runs on one io_context, on the calling thread: the connect, the read loop, the pings, the translator ticks and the
+ *	reconnects are coroutines on one strand. A stop request (should_stop, then GetClientStopNotifierInstance().Notify()) is handled on the strand.
+ *	The TLS context is the caller's, so that its sessions are resumed by later clients as well as by this one's reconnects.
+ */
+void WebSocketClient(
+	const std::string& host,
+	const std::string& port,
+	const std::string& session_token,
+	const std::string& client_type,
+	std::atomic<bool>& should_stop,
+	const ClientCallbacks& callbacks,
+	std::shared_ptr<sds::Translator> translatorPtr,
+	TlsClientContext& tls
+)
+{
+	const HeartbeatPolicy heartbeatPolicy{};
+	constexpr std::chrono::seconds latency_report_interval{ 60 };
+	const ThreadCpuTimes::Registration cpuRegistration(GetThreadCpuTimesInstance(), "client");
 
-			if (translatorPtr)
+	ReconnectManager reconnect{ ReconnectPolicy{} };
+	asio::io_context ioc{ 1 };
+	const auto run = std::make_shared<ClientRunState>(ioc);
+	{
+		const ClientStopNotifier::Registration stopRegistration(GetClientStopNotifierInstance(), [run, &client_type]()
 			{
-				auto cleanup_actions = translatorPtr->GetCleanupActions();
-				for (auto& ca : cleanup_actions)
-					ca();
-			}
-
-			if (ws.is_open()) {
-				boost::system::error_code ec;
-				ws.close(websocket::close_code::normal, ec);
-				if (ec &&
-					ec != boost::asio::error::eof &&
-					ec != boost::asio::ssl::error::stream_truncated &&
-					ec.category() != boost::asio::error::get_ssl_category()) // Optional filter
-				{
-					std::cerr << "[WARN] WebSocket close error: " << ec.message() << "\n";
-				}
-				else
-				{
-					std::cout << "[" << client_type << " Client] Connection closed gracefully.\n";
-				}
-			}
+				asio::co_spawn(run->Strand, StopClientRun(run, client_type), RethrowOnError);
+			});
+		// A stop requested before the registration.
+		if (should_stop.load())
+			return;
 
-			retry_count = 0; // Reset retry count on clean exit
-			break; // Exit loop normally
+		asio::co_spawn(run->Strand, RunClient(run, tls, host, port, session_token, client_type, callbacks, translatorPtr, reconnect, heartbeatPolicy), RethrowOnError);
+		asio::co_spawn(run->Strand, RunLatencyReports(run, latency_report_interval), RethrowOnError);
+		try {
+			// Returns once the client's coroutines have all ended.
+			ioc.run();
 		}
 		catch (const std::exception& e) {
-			if (should_stop.load())
-			{
-				return;
+			// From a callback, or the translator, the connection errors are handled by RunClient(...).
+			LogError("[ERROR] {} Client Error: {}", client_type, e.what());
+			if (callbacks.OnError)
+				callbacks.OnError(e.what());
+			run->HasGivenUp = true;
+			// RunClient(...) did not get to release the session's input, nothing may stay held down after the client ends.
+			try {
+				ReleaseHeldInput(translatorPtr, callbacks);
 			}
-
-			std::string errMsg = e.what();
-			std::cerr << "[ERROR] " << client_type << " Client Error: " << errMsg << "\n";
-			if (callbacks.OnError) {
-				callbacks.OnError(errMsg);
+			catch (const std::exception& releaseError) {
+				LogError("[ERROR] {} Client could not release the held input: {}", client_type, releaseError.what());
 			}
-
-			++retry_count;
-			std::cerr << "[INFO] Attempting to reconnect in " << reconnect_delay_ms << "ms...\n";
-			std::this_thread::sleep_for(std::chrono::milliseconds(reconnect_delay_ms));
 		}
 	}
-	if (callbacks.OnFailure)
+
+	if (run->HasGivenUp && !should_stop.load() && callbacks.OnFailure)
 	{
 		callbacks.CallOnNewThread(callbacks.OnFailure);
 	}
@@ -0,0 +1,261 @@
+#pragma once
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <ctime>
+#endif
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "StreamToActionTranslator.h"
+#include "InputLatency.h"
+
+/**
+ * \brief	The format of a received frame.
+ */
+enum class FrameFormat : uint8_t
+{
+	Text,
+	Binary,
+	Count
+};
+
+inline constexpr std::array<std::string_view, static_cast<std::size_t>(FrameFormat::Count)> FrameFormatNames
+{
+	"text", "binary"
+};
+
+/**
+ * \brief	Why a received message was not acted on.
+ */
+enum class RejectReason : uint8_t
+{
+	// Not valid JSON, a field of the wrong type, or a binary frame that does not decode.
+	Malformed,
+	// From a client that is not trusted, or a client slot not bound to a trusted client.
+	Untrusted,
+	// A binary frame not newer than the last one from its client slot.
+	Stale,
+	Count
+};
+
+inline constexpr std::array<std::string_view, static_cast<std::size_t>(RejectReason::Count)> RejectReasonNames
+{
+	"malformed", "untrusted", "stale"
+};
+
+/**
+ * \brief	Counters of the received messages and of the translator's work, updated with relaxed atomics on the client thread,
+ *	so counting is an uncontended increment, and read from any thread.
+ * \remarks	Commands are counted by command keycode, actions by mapping index and transition, mappings past MaxMappings are counted together.
+ */
+struct ClientMetrics
+{
+	static constexpr std::size_t CommandKeycodeCount{ 64 };
+	static constexpr std::size_t MaxMappings{ 128 };
+	// Init (a reset), KeyDown, KeyRepeat, KeyUp, the values of sds::ActionState.
+	static constexpr std::size_t TransitionCount{ 4 };
+
+	std::array<std::atomic<uint64_t>, static_cast<std::size_t>(FrameFormat::Count)> MessagesReceived{};
+	std::atomic<uint64_t> MessagesParsed{};
+	std::array<std::atomic<uint64_t>, static_cast<std::size_t>(RejectReason::Count)> MessagesRejected{};
+	// Every command received from a trusted client, including repeats of the current key state.
+	std::array<std::atomic<uint64_t>, CommandKeycodeCount> CommandsDown{};
+	std::array<std::atomic<uint64_t>, CommandKeycodeCount> CommandsUp{};
+	std::array<std::array<std::atomic<uint64_t>, TransitionCount>, MaxMappings + 1> Actions{};
+	// Time from a translator tick's clock read, once its input is taken, to its injected input submitted.
+	LatencyHistogram TickDuration;
+
+	void RecordReceived(const FrameFormat format) noexcept
+	{
+		MessagesReceived[static_cast<std::size_t>(format)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void RecordParsed() noexcept
+	{
+		MessagesParsed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void RecordRejected(const RejectReason reason) noexcept
+	{
+		MessagesRejected[static_cast<std::size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void RecordCommand(const int32_t keycode, const bool isDown) noexcept
+	{
+		if (keycode >= 0 && static_cast<std::size_t>(keycode) < CommandKeycodeCount)
+			(isDown ? CommandsDown : CommandsUp)[static_cast<std::size_t>(keycode)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void RecordAction(const sds::TransitionRecord record) noexcept
+	{
+		const auto transition = static_cast<std::size_t>(record.Transition);
+		if (transition < TransitionCount)
+			Actions[std::min<std::size_t>(record.MappingIndex, MaxMappings)][transition].fetch_add(1, std::memory_order_relaxed);
+	}
+};
+
+// get global client metrics instance
+inline ClientMetrics& GetClientMetricsInstance()
+{
+	static ClientMetrics instance;
+	return instance;
+}
+
+/**
+ * \brief	The threads whose CPU time is reported, each registered by the thread itself for as long as it runs.
+ * \remarks	The CPU time is read with GetThreadTimes on Windows and the thread's CPU-time clock on Linux, elsewhere it is not available.
+ */
+class ThreadCpuTimes
+{
+#if defined(_WIN32)
+	using Handle_t = HANDLE;
+#elif defined(__linux__)
+	using Handle_t = clockid_t;
+#else
+	using Handle_t = int;
+#endif
+	struct Entry
+	{
+		uint64_t Id{};
+		std::string Name;
+		Handle_t Handle{};
+	};
+
+	std::mutex m_mutex;
+	std::vector<Entry> m_threads;
+	uint64_t m_nextId{};
+public:
+	/**
+	 * \brief	Registers the calling thread under the name, for the lifetime of the Registration.
+	 */
+	class [[nodiscard]] Registration
+	{
+		ThreadCpuTimes& m_times;
+		std::optional<uint64_t> m_id;
+	public:
+		Registration(ThreadCpuTimes& times, std::string name) : m_times(times), m_id(times.Add(std::move(name))) { }
+		Registration(const Registration&) = delete;
+		auto operator=(const Registration&) -> Registration & = delete;
+		~Registration()
+		{
+			if (m_id)
+				m_times.Remove(*m_id);
+		}
+	};
+
+	/**
+	 * \brief	Calls fn(name, cpuTime) for each registered thread.
+	 */
+	void ForEach(const std::function<void(const std::string&, std::chrono::nanoseconds)>& fn)
+	{
+		std::lock_guard lock(m_mutex);
+		for (const auto& entry : m_threads)
+		{
+			if (const auto cpuTime = ReadCpuTime(entry.Handle))
+				fn(entry.Name, *cpuTime);
+		}
+	}
+
+	/**
+	 * \brief	The CPU time of the whole process, all threads.
+	 */
+	[[nodiscard]] static auto GetProcessCpuTime() -> std::optional<std::chrono::nanoseconds>
+	{
+#if defined(_WIN32)
+		FILETIME creation{}, exit{}, kernel{}, user{};
+		if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+			return {};
+		return FromFileTimes(kernel, user);
+#elif defined(__linux__)
+		return ReadClock(CLOCK_PROCESS_CPUTIME_ID);
+#else
+		return {};
+#endif
+	}
+private:
+	auto Add(std::string name) -> std::optional<uint64_t>
+	{
+#if defined(_WIN32)
+		const HANDLE handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, GetCurrentThreadId());
+		if (handle == nullptr)
+			return {};
+#elif defined(__linux__)
+		clockid_t handle{};
+		if (pthread_getcpuclockid(pthread_self(), &handle) != 0)
+			return {};
+#else
+		const Handle_t handle{};
+#endif
+		std::lock_guard lock(m_mutex);
+		const auto id = m_nextId++;
+		m_threads.push_back({ .Id = id, .Name = std::move(name), .Handle = handle });
+		return id;
+	}
+
+	void Remove(const uint64_t id)
+	{
+		std::lock_guard lock(m_mutex);
+		std::erase_if(m_threads, [id](const Entry& entry)
+			{
+				if (entry.Id != id)
+					return false;
+#if defined(_WIN32)
+				CloseHandle(entry.Handle);
+#endif
+				return true;
+			});
+	}
+
+#if defined(_WIN32)
+	static auto FromFileTimes(const FILETIME kernel, const FILETIME user) -> std::chrono::nanoseconds
+	{
+		const auto toTicks = [](const FILETIME time) { return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+		// FILETIME counts 100ns intervals.
+		return std::chrono::nanoseconds{ static_cast<int64_t>((toTicks(kernel) + toTicks(user)) * 100) };
+	}
+#elif defined(__linux__)
+	static auto ReadClock(const clockid_t clock) -> std::optional<std::chrono::nanoseconds>
+	{
+		timespec time{};
+		if (clock_gettime(clock, &time) != 0)
+			return {};
+		return std::chrono::seconds{ time.tv_sec } + std::chrono::nanoseconds{ time.tv_nsec };
+	}
+#endif
+
+	static auto ReadCpuTime([[maybe_unused]] const Handle_t handle) -> std::optional<std::chrono::nanoseconds>
+	{
+#if defined(_WIN32)
+		FILETIME creation{}, exit{}, kernel{}, user{};
+		if (!GetThreadTimes(handle, &creation, &exit, &kernel, &user))
+			return {};
+		return FromFileTimes(kernel, user);
+#elif defined(__linux__)
+		return ReadClock(handle);
+#else
+		return {};
+#endif
+	}
+};
+
+// get global thread CPU times instance
+inline ThreadCpuTimes& GetThreadCpuTimesInstance()
+{
+	static ThreadCpuTimes instance;
+	return instance;
+}
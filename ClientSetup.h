@@ -1,9 +1,13 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <optional>
 #include <string>
 #include <nlohmann/json.hpp>
 #include "ClientFunctionality.h"
+#include "MetricsServer.h"
+#include "Logger.h"
 
 using json = nlohmann::json;
 
@@ -13,7 +17,7 @@ const std::string CONFIG_FILE = "session_config.json";
 std::string ReadSessionToken() {
     std::ifstream file(CONFIG_FILE);
     if (!file) {
-        std::cerr << "Error: Could not open " << CONFIG_FILE << "\n";
+        LogError("Error: Could not open {}", CONFIG_FILE);
         return "";
     }
 
@@ -24,19 +28,49 @@ std::string ReadSessionToken() {
             return config["session_token"].get<std::string>();
         }
         else {
-            std::cerr << "Error: 'session_token' missing in " << CONFIG_FILE << "\n";
+            LogError("Error: 'session_token' missing in {}", CONFIG_FILE);
             return "";
         }
     }
     catch (const std::exception& e) {
-        std::cerr << "JSON parsing error: " << e.what() << "\n";
+        LogError("JSON parsing error: {}", e.what());
         return "";
     }
 }
 
+// Reads the port of the local metrics endpoint, the optional "metrics_port" in the JSON config file. None if it is not set, the endpoint is then not served.
+std::optional<uint16_t> ReadMetricsPort() {
+    std::ifstream file(CONFIG_FILE);
+    if (!file)
+        return std::nullopt;
+
+    json config;
+    try {
+        file >> config;
+        if (!config.contains("metrics_port"))
+            return std::nullopt;
+        const auto port = config["metrics_port"].get<int>();
+        if (port <= 0 || port > 65535) {
+            LogError("Error: 'metrics_port' {} in {} is not a port number", port, CONFIG_FILE);
+            return std::nullopt;
+        }
+        return static_cast<uint16_t>(port);
+    }
+    catch (const std::exception& e) {
+        LogError("JSON parsing error: {}", e.what());
+        return std::nullopt;
+    }
+}
+
 void SaveSessionToken(const std::string& newSessionToken)
 {
-    nlohmann::json j;
+    // The other settings (e.g. "metrics_port") are kept.
+    nlohmann::json j = nlohmann::json::object();
+    if (std::ifstream file(CONFIG_FILE); file) {
+        j = nlohmann::json::parse(file, nullptr, false);
+        if (!j.is_object())
+            j = nlohmann::json::object();
+    }
     j["session_token"] = newSessionToken;
     std::ofstream ofs(CONFIG_FILE);
     ofs << j.dump(4);
@@ -48,15 +82,16 @@ void StartArcClient(
     const std::string& sessionToken, 
     std::atomic<bool>& should_stop,
     const ClientCallbacks& callbacks,
-    std::shared_ptr<sds::Translator> translatorPtr)
+    std::shared_ptr<sds::Translator> translatorPtr,
+    TlsClientContext& tls)
 {
     if (sessionToken.empty()) {
-        std::cerr << "Error: No valid session token found. Exiting.\n";
+        LogError("Error: No valid session token found. Exiting.");
         return;
     }
 
-    std::cout << "[Session] Connecting to " << serverAddress << ":" << portString << '\n';
-    WebSocketClient(serverAddress, portString, sessionToken, "desktop", should_stop, callbacks, translatorPtr);
+    LogInfo("[Session] Connecting to {}:{}", serverAddress, portString);
+    WebSocketClient(serverAddress, portString, sessionToken, "desktop", should_stop, callbacks, translatorPtr, tls);
     return;
 }
 
@@ -71,6 +106,11 @@ struct WebSocketClientGlobal
     std::string CurrentSessionToken;
     std::atomic<bool> IsStopRequested{};
     std::shared_ptr<sds::Translator> translatorPtr{};
+    // Kept for every client thread, so a new session token or a reconnect resumes the TLS session instead of a full handshake.
+    TlsClientContext TlsContext;
+    // The local metrics endpoint, if "metrics_port" is configured. Started once, it outlives the client threads and their translators,
+    // it labels the actions with the keycodes of DriverMappingTable, which every translator is made from.
+    std::unique_ptr<MetricsServer> Metrics;
 private:
     HWND m_uiHwnd{};
     std::mutex threadUpdateMutex;
@@ -82,10 +122,22 @@ public:
     {
         m_uiHwnd = uiHwnd;
         translatorPtr = std::make_shared<sds::Translator>(GetAllMappings(uiHwnd));
+        Callbacks.DispatchTransition = [uiHwnd](const sds::TransitionRecord record)
+            {
+                DispatchDriverTransition(record, uiHwnd);
+            };
+        if (!Metrics) {
+            if (const auto metricsPort = ReadMetricsPort()) {
+                std::vector<int32_t> mappingKeycodes;
+                for (const auto& mapping : DriverMappingTable)
+                    mappingKeycodes.push_back(mapping.ButtonVirtualKeycode);
+                Metrics = std::make_unique<MetricsServer>(*metricsPort, std::move(mappingKeycodes));
+            }
+        }
         std::scoped_lock lock(threadUpdateMutex);
         CurrentSessionToken = std::move(sessionToken);
         IsStopRequested.store(false);
-        ClientThread = std::thread([&]() { StartArcClient(PortString, ServerAddress, CurrentSessionToken, IsStopRequested, Callbacks, translatorPtr); });
+        ClientThread = std::thread([&]() { StartArcClient(PortString, ServerAddress, CurrentSessionToken, IsStopRequested, Callbacks, translatorPtr, TlsContext); });
     }
 
     ~WebSocketClientGlobal() noexcept
@@ -101,7 +153,7 @@ public:
         CurrentSessionToken = std::move(sessionTokenUpdate);
         IsStopRequested.store(false);
         ClientThread = std::thread([&]() {
-            StartArcClient(PortString, ServerAddress, CurrentSessionToken, IsStopRequested, Callbacks, translatorPtr);
+            StartArcClient(PortString, ServerAddress, CurrentSessionToken, IsStopRequested, Callbacks, translatorPtr, TlsContext);
             });
     }
 
@@ -112,6 +164,7 @@ public:
         {
             std::scoped_lock lock(threadUpdateMutex);
             IsStopRequested.store(true);
+            GetClientStopNotifierInstance().Notify();
 
             if (ClientThread.joinable() && ClientThread.get_id() != std::this_thread::get_id()) {
                 std::swap(localThread, ClientThread);
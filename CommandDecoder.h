@@ -0,0 +1,151 @@
+#pragma once
+#include <string_view>
+#include <optional>
+#include <cstdint>
+
+/**
+ * \brief	A "command" message decoded in place, the views refer to the bytes of the frame and are only valid for as long as the frame is.
+ */
+struct CommandMessage
+{
+	std::string_view Command;
+	std::string_view State;
+	// Empty if the message has no "client_id".
+	std::optional<std::string_view> ClientId;
+	// The sender's Unix time in milliseconds when it sent the message ("sent_at"), empty if the message has none.
+	std::optional<uint64_t> SentTime;
+};
+
+namespace detail
+{
+	/**
+	 * \brief	Forward-only reader of the few JSON tokens that make up a flat object of plain strings. Every function returns false (or empty)
+	 *	for anything it does not handle, and the caller gives up on the fast path.
+	 */
+	class FlatJsonCursor
+	{
+		std::string_view m_text;
+		std::size_t m_pos{};
+	public:
+		explicit constexpr FlatJsonCursor(const std::string_view text) noexcept : m_text(text) { }
+
+		constexpr void SkipWhitespace() noexcept
+		{
+			while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r'))
+				++m_pos;
+		}
+
+		[[nodiscard]] constexpr bool Consume(const char c) noexcept
+		{
+			SkipWhitespace();
+			if (m_pos >= m_text.size() || m_text[m_pos] != c)
+				return false;
+			++m_pos;
+			return true;
+		}
+
+		/**
+		 * \brief	Reads a string token, only plain printable ASCII without escapes, so the view is exactly the decoded value.
+		 */
+		[[nodiscard]] constexpr auto ReadString() noexcept -> std::optional<std::string_view>
+		{
+			if (!Consume('"'))
+				return {};
+			const auto start = m_pos;
+			for (; m_pos < m_text.size(); ++m_pos)
+			{
+				const auto c = static_cast<unsigned char>(m_text[m_pos]);
+				if (c == '"')
+					return m_text.substr(start, m_pos++ - start);
+				if (c == '\\' || c < 0x20 || c >= 0x80)
+					return {};
+			}
+			return {};
+		}
+
+		/**
+		 * \brief	Reads a non-negative integer token, only plain digits (no sign, fraction or exponent) that fit in 64 bits.
+		 */
+		[[nodiscard]] constexpr auto ReadUnsigned() noexcept -> std::optional<uint64_t>
+		{
+			SkipWhitespace();
+			const auto start = m_pos;
+			uint64_t value{};
+			for (; m_pos < m_text.size() && m_text[m_pos] >= '0' && m_text[m_pos] <= '9'; ++m_pos)
+			{
+				const auto digit = static_cast<uint64_t>(m_text[m_pos] - '0');
+				if (value > (UINT64_MAX - digit) / 10)
+					return {};
+				value = value * 10 + digit;
+			}
+			// A fraction or exponent is a number the full parse would not read as an unsigned integer.
+			if (m_pos == start || (m_pos < m_text.size() && (m_text[m_pos] == '.' || m_text[m_pos] == 'e' || m_text[m_pos] == 'E')))
+				return {};
+			return value;
+		}
+
+		[[nodiscard]] constexpr bool IsAtEnd() noexcept
+		{
+			SkipWhitespace();
+			return m_pos == m_text.size();
+		}
+	};
+}
+
+/**
+ * \brief	Decodes the common {"command": ..., "state": ..., "client_id": ..., "sent_at": ...} message without copying or allocating.
+ * \remarks	Only a flat object of exactly those keys (client_id and sent_at optional, any order) with plain string values, and an unsigned integer
+ *	"sent_at", is decoded. Anything else, including
+ *	escapes, non-ASCII text, other keys, or duplicate keys, returns an empty optional and is left to the full nlohmann::json parse,
+ *	so the fast path never gives a message a different meaning than the full parse would.
+ */
+[[nodiscard]] constexpr auto DecodeCommandMessage(const std::string_view frame) noexcept -> std::optional<CommandMessage>
+{
+	detail::FlatJsonCursor cursor{ frame };
+	if (!cursor.Consume('{'))
+		return {};
+
+	std::optional<std::string_view> command;
+	std::optional<std::string_view> state;
+	std::optional<std::string_view> clientId;
+	std::optional<uint64_t> sentTime;
+	do
+	{
+		const auto key = cursor.ReadString();
+		if (!key || !cursor.Consume(':'))
+			return {};
+		if (*key == "sent_at")
+		{
+			if (sentTime)
+				return {};
+			sentTime = cursor.ReadUnsigned();
+			if (!sentTime)
+				return {};
+			continue;
+		}
+		const auto value = cursor.ReadString();
+		if (!value)
+			return {};
+
+		auto* const field = *key == "command" ? &command
+			: *key == "state" ? &state
+			: *key == "client_id" ? &clientId
+			: nullptr;
+		if (field == nullptr || field->has_value())
+			return {};
+		*field = value;
+	} while (cursor.Consume(','));
+
+	if (!cursor.Consume('}') || !cursor.IsAtEnd() || !command || !state)
+		return {};
+	return CommandMessage{ .Command = *command, .State = *state, .ClientId = clientId, .SentTime = sentTime };
+}
+
+static_assert(DecodeCommandMessage(R"({"command":"move_up","state":"keydown","client_id":"abc"})")->ClientId == "abc");
+static_assert(DecodeCommandMessage(R"( { "state" : "keyup" , "command" : "stop" } )")->Command == "stop");
+static_assert(!DecodeCommandMessage(R"({"command":"move_up","state":"keydown","type":"x"})"));
+static_assert(!DecodeCommandMessage(R"({"command":"move_\u0075p","state":"keydown"})"));
+static_assert(!DecodeCommandMessage(R"({"command":"stop","command":"stop","state":"keydown"})"));
+static_assert(DecodeCommandMessage(R"({"command":"stop","state":"keyup","sent_at":1700000000123})")->SentTime == 1700000000123u);
+static_assert(!DecodeCommandMessage(R"({"command":"stop","state":"keyup","sent_at":1.5})"));
+static_assert(!DecodeCommandMessage(R"({"command":"stop","state":"keyup","sent_at":"1"})"));
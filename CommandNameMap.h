@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <bit>
+#include <optional>
+#include <string_view>
+#include <stdexcept>
+
+/**
+ * \brief	A command name and the keycode it sends.
+ */
+struct CommandName
+{
+	std::string_view Name;
+	int32_t Keycode{};
+};
+
+/**
+ * \brief	Compile-time perfect hash map of command names to keycodes. A lookup is one hash of the name, and one comparison with the single
+ *	entry the hash selects, there are no collisions to probe and nothing is allocated.
+ * \remarks	The hash seed is searched for at compile time, so that every name has a slot of its own in a table of four times the entry count.
+ *	Entries with an empty name (a keycode with no command) are left out.
+ */
+template<std::size_t Size_v>
+class CommandNameMap
+{
+	static constexpr std::size_t TableSize{ std::bit_ceil(Size_v * 4) };
+	static constexpr int TableBits{ std::countr_zero(TableSize) };
+	static constexpr uint32_t MaxSeedAttempts{ 10'000 };
+
+	std::array<CommandName, TableSize> m_slots{};
+	uint32_t m_seed{};
+public:
+	consteval explicit CommandNameMap(const std::array<CommandName, Size_v>& entries)
+	{
+		for (std::size_t i{}; i < Size_v; ++i)
+		{
+			for (std::size_t j{ i + 1 }; j < Size_v; ++j)
+			{
+				if (!entries[i].Name.empty() && entries[i].Name == entries[j].Name)
+					throw std::logic_error("Exception: Duplicate command name!");
+			}
+		}
+		for (uint32_t seed{ 1 }; seed <= MaxSeedAttempts; ++seed)
+		{
+			if (TryPlace(entries, seed))
+			{
+				m_seed = seed;
+				return;
+			}
+		}
+		throw std::logic_error("Exception: No perfect hash seed found for the command names!");
+	}
+
+	/**
+	 * \brief	The keycode of the command name, empty if it is not a command.
+	 */
+	[[nodiscard]] constexpr auto Find(const std::string_view name) const noexcept -> std::optional<int32_t>
+	{
+		const auto& slot = m_slots[GetSlot(name, m_seed)];
+		if (slot.Name.empty() || slot.Name != name)
+			return {};
+		return slot.Keycode;
+	}
+
+	/**
+	 * \brief	The table slots, in hash order. Unused slots have an empty name.
+	 */
+	[[nodiscard]] constexpr auto GetSlots() const noexcept -> const std::array<CommandName, TableSize>&
+	{
+		return m_slots;
+	}
+private:
+	// FNV-1a, then multiplicative hashing to take the high bits as the slot index.
+	[[nodiscard]] static constexpr auto GetSlot(const std::string_view name, const uint32_t seed) noexcept -> std::size_t
+	{
+		uint32_t hash{ 2166136261u ^ seed };
+		for (const char c : name)
+			hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+		return static_cast<std::size_t>((hash * 0x9E3779B1u) >> (32 - TableBits));
+	}
+
+	consteval bool TryPlace(const std::array<CommandName, Size_v>& entries, const uint32_t seed)
+	{
+		m_slots = {};
+		for (const auto& entry : entries)
+		{
+			if (entry.Name.empty())
+				continue;
+			auto& slot = m_slots[GetSlot(entry.Name, seed)];
+			if (!slot.Name.empty())
+				return false;
+			slot = entry;
+		}
+		return true;
+	}
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <boost/beast/websocket.hpp>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "Logger.h"
+
+namespace websocket = boost::beast::websocket;
+
+/**
+ * \brief	Timing of the heartbeat pings, and how many may go unanswered before the connection is taken to be dead.
+ */
+struct HeartbeatPolicy
+{
+	// A ping is sent on connecting, then every Interval. A ping whose pong has not arrived when the next one is due is missed.
+	std::chrono::milliseconds Interval{ 3'000 };
+	// Consecutive missed pongs after which the connection is closed and a reconnect started, so a half-open connection is found
+	// within about MissedPongLimit * Interval.
+	int MissedPongLimit{ 3 };
+};
+
+/**
+ * \brief	Heartbeat counters and round trip time statistics, updated with relaxed atomics so they can be read from any thread.
+ *	The smoothed RTT and its variation are computed as TCP does (RFC 6298), a zero RTT means none has been measured.
+ */
+struct HeartbeatMetrics
+{
+	std::atomic<uint64_t> PingsSent{};
+	std::atomic<uint64_t> PongsReceived{};
+	std::atomic<uint64_t> MissedPongs{};
+	std::atomic<uint64_t> DeadConnections{};
+	std::atomic<uint64_t> LastRttMicros{};
+	std::atomic<uint64_t> MinRttMicros{};
+	std::atomic<uint64_t> MaxRttMicros{};
+	std::atomic<uint64_t> SmoothedRttMicros{};
+	std::atomic<uint64_t> RttVariationMicros{};
+
+	void RecordRtt(const std::chrono::steady_clock::duration rtt) noexcept
+	{
+		const auto micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(rtt).count());
+		LastRttMicros.store(micros, std::memory_order_relaxed);
+		// Only the client thread writes, so the loads then stores do not lose an update.
+		const auto minRtt = MinRttMicros.load(std::memory_order_relaxed);
+		if (minRtt == 0 || micros < minRtt)
+			MinRttMicros.store(micros, std::memory_order_relaxed);
+		if (micros > MaxRttMicros.load(std::memory_order_relaxed))
+			MaxRttMicros.store(micros, std::memory_order_relaxed);
+
+		const auto smoothed = SmoothedRttMicros.load(std::memory_order_relaxed);
+		if (smoothed == 0)
+		{
+			SmoothedRttMicros.store(micros, std::memory_order_relaxed);
+			RttVariationMicros.store(micros / 2, std::memory_order_relaxed);
+			return;
+		}
+		const auto deviation = micros > smoothed ? micros - smoothed : smoothed - micros;
+		const auto variation = RttVariationMicros.load(std::memory_order_relaxed);
+		RttVariationMicros.store(variation - variation / 4 + deviation / 4, std::memory_order_relaxed);
+		SmoothedRttMicros.store(smoothed - smoothed / 8 + micros / 8, std::memory_order_relaxed);
+	}
+};
+
+// get global heartbeat metrics instance
+inline HeartbeatMetrics& GetHeartbeatMetricsInstance()
+{
+	static HeartbeatMetrics instance;
+	return instance;
+}
+
+/**
+ * \brief	The pings of one connection, each carries a sequence number that its pong echoes, so a pong is matched to the ping's send time.
+ * \remarks	A pong for an earlier ping (late rather than lost) still shows the connection is alive, and is timed while its ping is among
+ *	the last SentHistory sent. Used on the connection's strand only, the pongs are reported by the websocket stream's control callback.
+ */
+class Heartbeat
+{
+	static constexpr std::size_t SentHistory{ 8 };
+
+	HeartbeatPolicy m_policy;
+	std::array<std::chrono::steady_clock::time_point, SentHistory> m_sentTimes{};
+	uint64_t m_nextSequence{};
+	// Sequence number of the latest ping answered, empty if none has been.
+	std::optional<uint64_t> m_lastAnswered;
+	int m_missedPongs{};
+public:
+	explicit Heartbeat(const HeartbeatPolicy& policy) : m_policy(policy) { }
+
+	[[nodiscard]] auto GetPolicy() const noexcept -> const HeartbeatPolicy&
+	{
+		return m_policy;
+	}
+
+	/**
+	 * \brief	The next ping to send, counting the previous one as missed if its pong has not arrived.
+	 */
+	[[nodiscard]] auto MakePing(const std::chrono::steady_clock::time_point now) -> websocket::ping_data
+	{
+		if (m_nextSequence != 0 && m_lastAnswered != m_nextSequence - 1)
+		{
+			++m_missedPongs;
+			GetHeartbeatMetricsInstance().MissedPongs.fetch_add(1, std::memory_order_relaxed);
+		}
+		const auto sequence = m_nextSequence++;
+		m_sentTimes[sequence % SentHistory] = now;
+		GetHeartbeatMetricsInstance().PingsSent.fetch_add(1, std::memory_order_relaxed);
+
+		std::array<char, 24> digits{};
+		const auto converted = std::to_chars(digits.data(), digits.data() + digits.size(), sequence);
+		return websocket::ping_data(digits.data(), static_cast<std::size_t>(converted.ptr - digits.data()));
+	}
+
+	/**
+	 * \brief	Handles a pong, one that does not echo a ping of this connection is ignored.
+	 */
+	void OnPong(const std::string_view payload, const std::chrono::steady_clock::time_point now)
+	{
+		uint64_t sequence{};
+		const auto parsed = std::from_chars(payload.data(), payload.data() + payload.size(), sequence);
+		if (parsed.ec != std::errc{} || parsed.ptr != payload.data() + payload.size() || sequence >= m_nextSequence)
+			return;
+		GetHeartbeatMetricsInstance().PongsReceived.fetch_add(1, std::memory_order_relaxed);
+		m_missedPongs = 0;
+		// A repeated pong, or one overtaken by a later ping's, is not timed.
+		if (m_lastAnswered && sequence <= *m_lastAnswered)
+			return;
+		m_lastAnswered = sequence;
+		if (m_nextSequence - sequence <= SentHistory)
+			GetHeartbeatMetricsInstance().RecordRtt(now - m_sentTimes[sequence % SentHistory]);
+	}
+
+	/**
+	 * \brief	true once MissedPongLimit pongs in a row have been missed.
+	 */
+	[[nodiscard]] bool IsDead() const noexcept
+	{
+		return m_missedPongs >= m_policy.MissedPongLimit;
+	}
+
+	[[nodiscard]] auto GetMissedPongs() const noexcept -> int
+	{
+		return m_missedPongs;
+	}
+};
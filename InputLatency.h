@@ -0,0 +1,183 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include "Logger.h"
+
+/**
+ * \brief	Histogram of durations in nanoseconds with HDR-style buckets: exact below 2 * SubBucketCount ns, above that each power of two range
+ *	is split into SubBucketCount equal buckets, so a recorded value is within 1/SubBucketCount (about 3%) of its bucket's bound.
+ * \remarks	Lock-free, every Record(...) is a few relaxed atomic increments, and may be called from any thread while another reads the percentiles.
+ *	Values above MaxValue are counted in the last bucket, the maximum is still exact.
+ */
+class LatencyHistogram
+{
+public:
+	static constexpr unsigned SubBucketBits{ 5 };
+	static constexpr uint64_t SubBucketCount{ uint64_t{ 1 } << SubBucketBits };
+	// About 18 minutes.
+	static constexpr unsigned MaxValueBits{ 40 };
+	static constexpr uint64_t MaxValue{ (uint64_t{ 1 } << MaxValueBits) - 1 };
+	static constexpr std::size_t BucketCount{ (MaxValueBits - SubBucketBits + 1) * SubBucketCount };
+private:
+	std::array<std::atomic<uint64_t>, BucketCount> m_buckets{};
+	std::atomic<uint64_t> m_count{};
+	std::atomic<uint64_t> m_total{};
+	std::atomic<uint64_t> m_max{};
+public:
+	[[nodiscard]] static constexpr auto GetBucketIndex(const uint64_t value) noexcept -> std::size_t
+	{
+		const auto clamped = std::min(value, MaxValue);
+		if (clamped < 2 * SubBucketCount)
+			return static_cast<std::size_t>(clamped);
+		const auto shift = static_cast<unsigned>(std::bit_width(clamped)) - (SubBucketBits + 1);
+		return static_cast<std::size_t>(shift * SubBucketCount + (clamped >> shift));
+	}
+
+	// The largest value recorded in the bucket.
+	[[nodiscard]] static constexpr auto GetBucketUpperBound(const std::size_t index) noexcept -> uint64_t
+	{
+		if (index < 2 * SubBucketCount)
+			return index;
+		const auto shift = static_cast<unsigned>(index / SubBucketCount - 1);
+		const auto subBucket = index % SubBucketCount + SubBucketCount;
+		return ((subBucket + 1) << shift) - 1;
+	}
+
+	void Record(const std::chrono::nanoseconds duration) noexcept
+	{
+		const auto value = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+		m_buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_total.fetch_add(value, std::memory_order_relaxed);
+		auto max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+	}
+
+	[[nodiscard]] auto GetCount() const noexcept -> uint64_t
+	{
+		return m_count.load(std::memory_order_relaxed);
+	}
+
+	// The sum of the recorded values.
+	[[nodiscard]] auto GetTotal() const noexcept -> std::chrono::nanoseconds
+	{
+		return std::chrono::nanoseconds{ m_total.load(std::memory_order_relaxed) };
+	}
+
+	[[nodiscard]] auto GetMax() const noexcept -> std::chrono::nanoseconds
+	{
+		return std::chrono::nanoseconds{ m_max.load(std::memory_order_relaxed) };
+	}
+
+	[[nodiscard]] auto GetMean() const noexcept -> std::chrono::nanoseconds
+	{
+		const auto count = GetCount();
+		return std::chrono::nanoseconds{ count == 0 ? 0 : m_total.load(std::memory_order_relaxed) / count };
+	}
+
+	/**
+	 * \brief	The value that the given fraction (e.g. 0.99) of the recorded values are at or below, as the bound of its bucket. Zero if there are none.
+	 * \remarks	Read while values are being recorded, the buckets are not one snapshot, the result is still within the recorded range.
+	 */
+	[[nodiscard]] auto GetPercentile(const double fraction) const noexcept -> std::chrono::nanoseconds
+	{
+		const auto count = GetCount();
+		if (count == 0)
+			return {};
+		const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count))));
+		uint64_t seen{};
+		for (std::size_t i{}; i < BucketCount; ++i)
+		{
+			seen += m_buckets[i].load(std::memory_order_relaxed);
+			if (seen >= rank)
+				return std::min(std::chrono::nanoseconds{ GetBucketUpperBound(i) }, GetMax());
+		}
+		return GetMax();
+	}
+};
+static_assert(LatencyHistogram::GetBucketIndex(LatencyHistogram::MaxValue) == LatencyHistogram::BucketCount - 1);
+static_assert(LatencyHistogram::GetBucketUpperBound(LatencyHistogram::GetBucketIndex(1000)) >= 1000
+	&& LatencyHistogram::GetBucketUpperBound(LatencyHistogram::GetBucketIndex(1000) - 1) < 1000);
+
+/**
+ * \brief	The legs of a command's path from the phone to the injected input, each an interval between two of the timestamps taken on the way.
+ */
+enum class LatencyStage : uint8_t
+{
+	// Sender timestamp to frame receipt, only for messages carrying one, and only meaningful when the clocks are synchronized.
+	Network,
+	// Frame receipt (the read completing) to the key-state update.
+	Decode,
+	// Key-state update to the translator tick picking up the edge.
+	Queue,
+	// Translator pickup to the tick's mapping operations performed and the injected input submitted.
+	Action,
+	// Frame receipt to the injected input submitted.
+	Total,
+	Count
+};
+
+inline constexpr std::array<std::string_view, static_cast<std::size_t>(LatencyStage::Count)> LatencyStageNames
+{
+	"network", "decode", "queue", "action", "total"
+};
+
+/**
+ * \brief	A latency histogram per stage, with a report of the percentiles written to the log, on demand (<c>Dump()</c>) or periodically.
+ */
+class InputLatency
+{
+	std::array<LatencyHistogram, static_cast<std::size_t>(LatencyStage::Count)> m_stages;
+	// The sample count at the last periodic report, a period without new samples is not reported.
+	std::atomic<uint64_t> m_reportedCount{};
+public:
+	void Record(const LatencyStage stage, const std::chrono::nanoseconds duration) noexcept
+	{
+		m_stages[static_cast<std::size_t>(stage)].Record(duration);
+	}
+
+	[[nodiscard]] auto GetHistogram(const LatencyStage stage) const noexcept -> const LatencyHistogram&
+	{
+		return m_stages[static_cast<std::size_t>(stage)];
+	}
+
+	/**
+	 * \brief	Writes the count and p50/p99/p99.9/max (in microseconds) of every stage with samples to the log.
+	 */
+	void Dump() const
+	{
+		const auto toMicros = [](const std::chrono::nanoseconds value) { return std::round(static_cast<double>(value.count()) / 100.0) / 10.0; };
+		for (std::size_t i{}; i < m_stages.size(); ++i)
+		{
+			const auto& histogram = m_stages[i];
+			if (histogram.GetCount() == 0)
+				continue;
+			LogInfo("[Latency] {}: n={} p50={}us p99={}us p99.9={}us max={}us", LatencyStageNames[i], histogram.GetCount(),
+				toMicros(histogram.GetPercentile(0.5)), toMicros(histogram.GetPercentile(0.99)), toMicros(histogram.GetPercentile(0.999)),
+				toMicros(histogram.GetMax()));
+		}
+	}
+
+	/**
+	 * \brief	Dump(), if there are samples since the last periodic report.
+	 */
+	void DumpIfChanged()
+	{
+		const auto count = GetHistogram(LatencyStage::Total).GetCount() + GetHistogram(LatencyStage::Network).GetCount();
+		if (m_reportedCount.exchange(count, std::memory_order_relaxed) != count)
+			Dump();
+	}
+};
+
+// get global input latency instance
+inline InputLatency& GetInputLatencyInstance()
+{
+	static InputLatency instance;
+	return instance;
+}
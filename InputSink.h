@@ -0,0 +1,324 @@
+#pragma once
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#endif
+#ifdef __linux__
+#include <linux/uinput.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <cstring>
+#include <cerrno>
+#endif
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <stdexcept>
+#include "Logger.h"
+
+enum class InjectedEventKind : uint8_t
+{
+	MouseMove,
+	MouseButton,
+	Key,
+	Wheel
+};
+
+enum class InjectedMouseButton : int32_t
+{
+	Left,
+	Right,
+	Middle
+};
+
+/**
+ * \brief	A single synthesized input event. Mouse movement is relative, in screen coordinates (positive Y is down).
+ *	Wheel deltas are in the Win32 units of WHEEL_DELTA (120) per notch, positive is away from the user.
+ */
+struct InjectedEvent
+{
+	InjectedEventKind Kind{};
+	int32_t X{};
+	int32_t Y{};
+	// Mouse button, or Win32 virtual key, depending on the kind.
+	int32_t Code{};
+	bool IsDown{};
+};
+
+/**
+ * \brief	Accumulates the input events injected during a tick, and submits them all at once on <c>Flush()</c>.
+ * \remarks	Consecutive mouse moves are coalesced into one. A backend implements <c>Submit(...)</c>, which is called with the whole batch,
+ *	so a tick costs one user/kernel transition rather than one per event.
+ *	Not thread-safe, it is written and flushed on the client thread, by the translator tick and by ReleaseHeldInput(...) when a connection ends.
+ */
+class InputSink
+{
+	std::vector<InjectedEvent> m_pending;
+public:
+	InputSink() = default;
+	InputSink(const InputSink&) = delete;
+	auto operator=(const InputSink&) -> InputSink & = delete;
+	virtual ~InputSink() = default;
+
+	void MouseMove(const int32_t dx, const int32_t dy)
+	{
+		if (!m_pending.empty() && m_pending.back().Kind == InjectedEventKind::MouseMove)
+		{
+			m_pending.back().X += dx;
+			m_pending.back().Y += dy;
+			return;
+		}
+		m_pending.push_back({ .Kind = InjectedEventKind::MouseMove, .X = dx, .Y = dy });
+	}
+
+	void MouseButton(const InjectedMouseButton button, const bool isDown)
+	{
+		m_pending.push_back({ .Kind = InjectedEventKind::MouseButton, .Code = static_cast<int32_t>(button), .IsDown = isDown });
+	}
+
+	void Key(const int32_t virtualKey, const bool isDown)
+	{
+		m_pending.push_back({ .Kind = InjectedEventKind::Key, .Code = virtualKey, .IsDown = isDown });
+	}
+
+	void Wheel(const int32_t delta)
+	{
+		m_pending.push_back({ .Kind = InjectedEventKind::Wheel, .Y = delta });
+	}
+
+	/**
+	 * \brief	Submits the pending events, if any, as one batch.
+	 */
+	void Flush()
+	{
+		if (m_pending.empty())
+			return;
+		Submit(m_pending);
+		m_pending.clear();
+	}
+
+	[[nodiscard]] auto GetPendingCount() const noexcept -> std::size_t
+	{
+		return m_pending.size();
+	}
+protected:
+	virtual void Submit(std::span<const InjectedEvent> events) = 0;
+};
+
+/**
+ * \brief	Keeps every submitted batch in memory, for tests and benchmarks.
+ */
+class RecordingInputSink final : public InputSink
+{
+public:
+	std::vector<InjectedEvent> Events;
+	std::size_t SubmitCount{};
+protected:
+	void Submit(const std::span<const InjectedEvent> events) override
+	{
+		Events.insert(Events.end(), events.begin(), events.end());
+		++SubmitCount;
+	}
+};
+
+#ifdef _WIN32
+/**
+ * \brief	Submits each batch with a single SendInput call.
+ * \remarks	A batch that is not fully injected (e.g. blocked by UIPI, the foreground window is of a higher integrity level) is logged.
+ */
+class Win32SendInputSink final : public InputSink
+{
+	std::vector<INPUT> m_inputs;
+protected:
+	void Submit(const std::span<const InjectedEvent> events) override
+	{
+		m_inputs.clear();
+		for (const auto& event : events)
+		{
+			INPUT input{};
+			switch (event.Kind)
+			{
+			case InjectedEventKind::MouseMove:
+				input.type = INPUT_MOUSE;
+				input.mi.dwFlags = MOUSEEVENTF_MOVE;
+				input.mi.dx = event.X;
+				input.mi.dy = event.Y;
+				break;
+			case InjectedEventKind::MouseButton:
+				input.type = INPUT_MOUSE;
+				input.mi.dwFlags = GetMouseButtonFlag(static_cast<InjectedMouseButton>(event.Code), event.IsDown);
+				break;
+			case InjectedEventKind::Key:
+				input.type = INPUT_KEYBOARD;
+				input.ki.wVk = static_cast<WORD>(event.Code);
+				input.ki.dwFlags = event.IsDown ? 0 : KEYEVENTF_KEYUP;
+				break;
+			case InjectedEventKind::Wheel:
+				input.type = INPUT_MOUSE;
+				input.mi.dwFlags = MOUSEEVENTF_WHEEL;
+				input.mi.mouseData = static_cast<DWORD>(event.Y);
+				break;
+			}
+			if (input.type == INPUT_MOUSE)
+				input.mi.dwExtraInfo = GetMessageExtraInfo();
+			else
+				input.ki.dwExtraInfo = GetMessageExtraInfo();
+			m_inputs.push_back(input);
+		}
+		const auto injected = SendInput(static_cast<UINT>(m_inputs.size()), m_inputs.data(), sizeof(INPUT));
+		if (injected != m_inputs.size())
+			LogWarn("[Input] SendInput injected {} of {} events, error {}.", injected, m_inputs.size(), GetLastError());
+	}
+private:
+	static auto GetMouseButtonFlag(const InjectedMouseButton button, const bool isDown) noexcept -> DWORD
+	{
+		switch (button)
+		{
+		case InjectedMouseButton::Left:
+			return isDown ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
+		case InjectedMouseButton::Right:
+			return isDown ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
+		case InjectedMouseButton::Middle:
+			return isDown ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
+		}
+		return 0;
+	}
+};
+#endif
+
+#ifdef __linux__
+/**
+ * \brief	Creates a virtual device with /dev/uinput, and submits each batch (terminated by a SYN_REPORT) with a single write.
+ *	A partial write is continued, a write that fails (e.g. EAGAIN, the device is non-blocking) is logged.
+ * \exception std::runtime_error if the device cannot be created.
+ */
+class UinputSink final : public InputSink
+{
+	int m_fd{ -1 };
+	std::vector<input_event> m_events;
+	// Hi-res wheel units not yet sent as a whole low-res notch.
+	int m_wheelRemainder{};
+public:
+	UinputSink()
+	{
+		m_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+		if (m_fd < 0)
+			throw std::runtime_error("Exception: Unable to open /dev/uinput!");
+
+		ioctl(m_fd, UI_SET_EVBIT, EV_REL);
+		ioctl(m_fd, UI_SET_RELBIT, REL_X);
+		ioctl(m_fd, UI_SET_RELBIT, REL_Y);
+		ioctl(m_fd, UI_SET_RELBIT, REL_WHEEL);
+		ioctl(m_fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+		ioctl(m_fd, UI_SET_EVBIT, EV_KEY);
+		for (const auto code : { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, KEY_PLAYPAUSE, KEY_NEXTSONG, KEY_PREVIOUSSONG,
+			KEY_VOLUMEUP, KEY_VOLUMEDOWN, KEY_MUTE, KEY_STOPCD, KEY_ESC })
+			ioctl(m_fd, UI_SET_KEYBIT, code);
+
+		uinput_setup setup{};
+		setup.id.bustype = BUS_VIRTUAL;
+		std::strncpy(setup.name, "arc_client virtual input", UINPUT_MAX_NAME_SIZE - 1);
+		if (ioctl(m_fd, UI_DEV_SETUP, &setup) < 0 || ioctl(m_fd, UI_DEV_CREATE) < 0)
+		{
+			close(m_fd);
+			throw std::runtime_error("Exception: Unable to create the uinput device!");
+		}
+	}
+	~UinputSink() override
+	{
+		ioctl(m_fd, UI_DEV_DESTROY);
+		close(m_fd);
+	}
+protected:
+	void Submit(const std::span<const InjectedEvent> events) override
+	{
+		m_events.clear();
+		const auto add = [this](const int type, const int code, const int value) { m_events.push_back({ .type = static_cast<__u16>(type), .code = static_cast<__u16>(code), .value = value }); };
+		for (const auto& event : events)
+		{
+			switch (event.Kind)
+			{
+			case InjectedEventKind::MouseMove:
+				if (event.X != 0)
+					add(EV_REL, REL_X, event.X);
+				if (event.Y != 0)
+					add(EV_REL, REL_Y, event.Y);
+				break;
+			case InjectedEventKind::MouseButton:
+				add(EV_KEY, GetButtonCode(static_cast<InjectedMouseButton>(event.Code)), event.IsDown ? 1 : 0);
+				break;
+			case InjectedEventKind::Key:
+				if (const auto code = GetKeyCode(event.Code); code != 0)
+					add(EV_KEY, code, event.IsDown ? 1 : 0);
+				break;
+			case InjectedEventKind::Wheel:
+				// Hi-res wheel units match the Win32 units, 120 per notch, the low-res event is in whole notches. Smooth scrolling sends
+				// fractions of a notch, they are accumulated (as the kernel's hid-input does for hi-res mice) so a reader of the low-res
+				// wheel still gets a notch for every 120 units.
+				add(EV_REL, REL_WHEEL_HI_RES, event.Y);
+				m_wheelRemainder += event.Y;
+				if (const auto notches = m_wheelRemainder / 120; notches != 0)
+				{
+					add(EV_REL, REL_WHEEL, notches);
+					m_wheelRemainder -= notches * 120;
+				}
+				break;
+			}
+		}
+		add(EV_SYN, SYN_REPORT, 0);
+		const auto* data = reinterpret_cast<const char*>(m_events.data());
+		std::size_t remaining{ m_events.size() * sizeof(input_event) };
+		while (remaining > 0)
+		{
+			const auto written = write(m_fd, data, remaining);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written <= 0)
+			{
+				LogWarn("[Input] uinput write failed, {} of {} events not injected: {}", remaining / sizeof(input_event), m_events.size(),
+					written < 0 ? std::strerror(errno) : "nothing written");
+				return;
+			}
+			data += written;
+			remaining -= static_cast<std::size_t>(written);
+		}
+	}
+private:
+	static auto GetButtonCode(const InjectedMouseButton button) noexcept -> int
+	{
+		switch (button)
+		{
+		case InjectedMouseButton::Left:
+			return BTN_LEFT;
+		case InjectedMouseButton::Right:
+			return BTN_RIGHT;
+		case InjectedMouseButton::Middle:
+			return BTN_MIDDLE;
+		}
+		return BTN_LEFT;
+	}
+
+	// Win32 virtual key to evdev key code, for the keys the driver mappings inject. Zero if there is none.
+	static auto GetKeyCode(const int32_t virtualKey) noexcept -> int
+	{
+		switch (virtualKey)
+		{
+		case 0xB3: return KEY_PLAYPAUSE; // VK_MEDIA_PLAY_PAUSE
+		case 0xB0: return KEY_NEXTSONG; // VK_MEDIA_NEXT_TRACK
+		case 0xB1: return KEY_PREVIOUSSONG; // VK_MEDIA_PREV_TRACK
+		case 0xAF: return KEY_VOLUMEUP; // VK_VOLUME_UP
+		case 0xAE: return KEY_VOLUMEDOWN; // VK_VOLUME_DOWN
+		case 0xAD: return KEY_MUTE; // VK_VOLUME_MUTE
+		case 0xB2: return KEY_STOPCD; // VK_MEDIA_STOP
+		case 0x1B: return KEY_ESC; // VK_ESCAPE
+		default: return 0;
+		}
+	}
+};
+#endif
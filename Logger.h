@@ -0,0 +1,477 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <concepts>
+#include <unordered_map>
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <type_traits>
+
+/**
+ * \brief	Single producer, single consumer, fixed capacity ring buffer. Push and Pop do not block and do not allocate.
+ * \remarks	Push() must only be called by the one producer thread, Pop() by the one consumer thread.
+ */
+template<typename Value_t, std::size_t Capacity_v>
+class SpscRing
+{
+	static_assert(std::has_single_bit(Capacity_v), "SpscRing capacity must be a power of two.");
+	static_assert(std::is_trivially_copyable_v<Value_t>);
+
+	std::array<Value_t, Capacity_v> m_values{};
+	// Separate cache lines, so the producer and the consumer do not write to the same one.
+	alignas(64) std::atomic<std::size_t> m_head{};
+	alignas(64) std::atomic<std::size_t> m_tail{};
+public:
+	/**
+	 * \return	false if the ring is full, the value is not added.
+	 */
+	bool Push(const Value_t& value) noexcept
+	{
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity_v)
+			return false;
+		m_values[tail % Capacity_v] = value;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	[[nodiscard]] auto Pop() noexcept -> std::optional<Value_t>
+	{
+		const auto head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return {};
+		const auto value = m_values[head % Capacity_v];
+		m_head.store(head + 1, std::memory_order_release);
+		return value;
+	}
+
+	/**
+	 * \brief	Called by the consumer, true if there is nothing to Pop().
+	 */
+	[[nodiscard]] bool IsEmpty() const noexcept
+	{
+		return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * \brief	The number of values waiting, for monitoring. May be called from any thread, the count is approximate while values are pushed or popped.
+	 */
+	[[nodiscard]] auto GetSize() const noexcept -> std::size_t
+	{
+		const auto head = m_head.load(std::memory_order_relaxed);
+		const auto tail = m_tail.load(std::memory_order_relaxed);
+		// The head read first cannot pass the tail read after it, but the tail may be read before the head catches up.
+		return tail >= head ? std::min(tail - head, Capacity_v) : 0;
+	}
+};
+
+enum class LogLevel : uint8_t
+{
+	Debug,
+	Info,
+	Warn,
+	Error
+};
+
+/**
+ * \brief	Messages below this level are compiled out, the call does nothing. Define ARC_LOG_MIN_LEVEL (0 Debug ... 3 Error) to override.
+ */
+#ifndef ARC_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define ARC_LOG_MIN_LEVEL 1
+#else
+#define ARC_LOG_MIN_LEVEL 0
+#endif
+#endif
+inline constexpr LogLevel MinLogLevel{ static_cast<LogLevel>(ARC_LOG_MIN_LEVEL) };
+
+/**
+ * \brief	One argument of a log record, captured by value. Text is copied into the record, so a view of a transient buffer may be logged.
+ */
+struct LogArgument
+{
+	enum class Kind : uint8_t { Signed, Unsigned, Float, Text };
+	Kind ArgumentKind{};
+	union
+	{
+		int64_t Signed;
+		uint64_t Unsigned;
+		double Float;
+		struct
+		{
+			uint16_t Offset;
+			uint16_t Length;
+		} Text;
+	};
+};
+
+/**
+ * \brief	A log message before formatting, the format string (a literal, "{}" for each argument) and the captured arguments.
+ *	Fixed size and trivially copyable, so it can be queued in a ring buffer without allocating.
+ */
+struct LogRecord
+{
+	static constexpr std::size_t MaxArguments{ 6 };
+	static constexpr std::size_t TextCapacity{ 192 };
+
+	const char* Format{};
+	std::chrono::steady_clock::time_point Time{};
+	LogLevel Level{};
+	uint8_t ArgumentCount{};
+	uint16_t TextSize{};
+	std::array<LogArgument, MaxArguments> Arguments{};
+	// Text arguments, truncated if they do not all fit.
+	std::array<char, TextCapacity> Text{};
+
+	void Add(const std::string_view text) noexcept
+	{
+		const auto length = std::min(text.size(), TextCapacity - TextSize);
+		std::copy_n(text.data(), length, Text.data() + TextSize);
+		auto& argument = Arguments[ArgumentCount++];
+		argument.ArgumentKind = LogArgument::Kind::Text;
+		argument.Text = { TextSize, static_cast<uint16_t>(length) };
+		TextSize = static_cast<uint16_t>(TextSize + length);
+	}
+
+	void Add(const std::signed_integral auto value) noexcept
+	{
+		auto& argument = Arguments[ArgumentCount++];
+		argument.ArgumentKind = LogArgument::Kind::Signed;
+		argument.Signed = value;
+	}
+
+	void Add(const std::unsigned_integral auto value) noexcept
+	{
+		auto& argument = Arguments[ArgumentCount++];
+		argument.ArgumentKind = LogArgument::Kind::Unsigned;
+		argument.Unsigned = value;
+	}
+
+	void Add(const std::floating_point auto value) noexcept
+	{
+		auto& argument = Arguments[ArgumentCount++];
+		argument.ArgumentKind = LogArgument::Kind::Float;
+		argument.Float = value;
+	}
+
+	void Add(const bool value) noexcept
+	{
+		Add(value ? std::string_view{ "true" } : std::string_view{ "false" });
+	}
+
+	void Add(const char* text) noexcept
+	{
+		Add(std::string_view{ text });
+	}
+
+	/**
+	 * \brief	Formats the message, each "{}" in the format is replaced by the next argument.
+	 */
+	[[nodiscard]] auto ToString() const -> std::string
+	{
+		std::string result;
+		std::size_t next{};
+		for (const char* c = Format; *c != '\0'; ++c)
+		{
+			if (c[0] == '{' && c[1] == '}' && next < ArgumentCount)
+			{
+				AppendArgument(result, Arguments[next++]);
+				++c;
+				continue;
+			}
+			result.push_back(*c);
+		}
+		return result;
+	}
+private:
+	void AppendArgument(std::string& out, const LogArgument& argument) const
+	{
+		std::array<char, 32> digits{};
+		std::to_chars_result converted{ digits.data() };
+		switch (argument.ArgumentKind)
+		{
+		case LogArgument::Kind::Signed:
+			converted = std::to_chars(digits.data(), digits.data() + digits.size(), argument.Signed);
+			break;
+		case LogArgument::Kind::Unsigned:
+			converted = std::to_chars(digits.data(), digits.data() + digits.size(), argument.Unsigned);
+			break;
+		case LogArgument::Kind::Float:
+			converted = std::to_chars(digits.data(), digits.data() + digits.size(), argument.Float);
+			break;
+		case LogArgument::Kind::Text:
+			out.append(Text.data() + argument.Text.Offset, argument.Text.Length);
+			return;
+		}
+		out.append(digits.data(), converted.ptr);
+	}
+};
+static_assert(std::is_trivially_copyable_v<LogRecord>);
+
+/**
+ * \brief	Asynchronous logger, a logging thread queues the record in a ring buffer of its own and returns, the background thread formats
+ *	and writes the records (Debug/Info to std::cout, Warn/Error to std::cerr).
+ * \remarks	Each thread that logs has its own single producer ring, so logging takes no lock after the first message of a thread, except to wake
+ *	the background thread when it is idle. The background thread sleeps until a record is queued, or a suppressed or dropped count is due.
+ *	If a ring is full (or a thread's ring cannot be created) the message is dropped and counted. A format that is logged more than RateLimit times in a RateWindow is suppressed
+ *	for the rest of the window, and the number suppressed is written when the window ends.
+ */
+class Logger
+{
+public:
+	static constexpr std::size_t RingCapacity{ 256 };
+	static constexpr std::size_t RateLimit{ 20 };
+	static constexpr std::chrono::seconds RateWindow{ 1 };
+private:
+	struct ThreadRing
+	{
+		SpscRing<LogRecord, RingCapacity> Records;
+		std::atomic<uint64_t> Dropped{};
+	};
+
+	struct RateState
+	{
+		std::chrono::steady_clock::time_point WindowStart{};
+		std::size_t Count{};
+		std::size_t Suppressed{};
+		LogLevel Level{};
+	};
+
+	const std::chrono::steady_clock::time_point m_startTime{ std::chrono::steady_clock::now() };
+	std::mutex m_ringsMutex;
+	std::vector<std::shared_ptr<ThreadRing>> m_rings;
+	// Held while draining, the rings have one consumer at a time (the background thread, or a caller of Flush()).
+	std::mutex m_drainMutex;
+	// Only used while holding m_drainMutex.
+	std::unordered_map<const char*, RateState> m_rates;
+	uint64_t m_dropped{};
+	std::chrono::steady_clock::time_point m_droppedReportTime{};
+	// Messages of threads whose ring could not be created.
+	std::atomic<uint64_t> m_droppedWithoutRing{};
+	// Set by the first record queued since the background thread last woke, the writer that sets it wakes the background thread.
+	std::atomic<bool> m_hasRecords{};
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	std::atomic<bool> m_stop{};
+	std::thread m_thread;
+public:
+	Logger() : m_thread([this]() { Run(); }) { }
+	Logger(const Logger&) = delete;
+	auto operator=(const Logger&) -> Logger & = delete;
+	~Logger()
+	{
+		{
+			std::lock_guard lock(m_wakeMutex);
+			m_stop.store(true);
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	template<typename... Args_t>
+	void Write(const LogLevel level, const char* format, const Args_t&... args) noexcept
+	{
+		static_assert(sizeof...(Args_t) <= LogRecord::MaxArguments, "Too many log arguments.");
+		LogRecord record{ .Format = format, .Time = std::chrono::steady_clock::now(), .Level = level };
+		(record.Add(args), ...);
+		if (const auto ring = GetThreadRing(); !ring)
+			m_droppedWithoutRing.fetch_add(1, std::memory_order_relaxed);
+		else if (!ring->Records.Push(record))
+			ring->Dropped.fetch_add(1, std::memory_order_relaxed);
+		Wake();
+	}
+
+	/**
+	 * \brief	Writes every record queued so far, before returning.
+	 */
+	void Flush()
+	{
+		Drain(std::chrono::steady_clock::now());
+		// The background thread then picks up the suppressed counts this drain may have started.
+		Wake();
+	}
+
+	/**
+	 * \brief	The number of records waiting to be written, for monitoring.
+	 */
+	[[nodiscard]] auto GetQueuedCount() -> std::size_t
+	{
+		std::lock_guard lock(m_ringsMutex);
+		std::size_t queued{};
+		for (const auto& ring : m_rings)
+			queued += ring->Records.GetSize();
+		return queued;
+	}
+private:
+	/**
+	 * \brief	The calling thread's ring, created and registered on its first message. Null if that fails (out of memory), it is tried again on the next message.
+	 */
+	auto GetThreadRing() noexcept -> ThreadRing*
+	{
+		// Shared with the logger, so the records of a thread that has exited are still written.
+		thread_local std::shared_ptr<ThreadRing> ring;
+		if (!ring)
+		{
+			try {
+				auto newRing = std::make_shared<ThreadRing>();
+				std::lock_guard lock(m_ringsMutex);
+				m_rings.push_back(newRing);
+				ring = std::move(newRing);
+			}
+			catch (const std::exception&) {
+				return nullptr;
+			}
+		}
+		return ring.get();
+	}
+
+	/**
+	 * \brief	Wakes the background thread, unless a record queued since it last woke has already done so.
+	 */
+	void Wake() noexcept
+	{
+		if (m_hasRecords.exchange(true))
+			return;
+		// Taking the lock orders the notify after the background thread's check of m_hasRecords, so the wake-up is not lost.
+		{
+			std::lock_guard lock(m_wakeMutex);
+		}
+		m_wake.notify_one();
+	}
+
+	void Run()
+	{
+		std::optional<std::chrono::steady_clock::time_point> nextReport;
+		std::unique_lock lock(m_wakeMutex);
+		while (!m_stop.load())
+		{
+			const auto isWoken = [this]() { return m_stop.load() || m_hasRecords.load(); };
+			if (nextReport)
+				m_wake.wait_until(lock, *nextReport, isWoken);
+			else
+				m_wake.wait(lock, isWoken);
+			m_hasRecords.store(false);
+			lock.unlock();
+			nextReport = Drain(std::chrono::steady_clock::now());
+			lock.lock();
+		}
+		lock.unlock();
+		Drain(std::chrono::steady_clock::now() + RateWindow);
+	}
+
+	/**
+	 * \brief	Writes the queued records, and the suppressed and dropped counts that are due.
+	 * \return	When the next suppressed or dropped count is due, empty if none is waiting.
+	 */
+	auto Drain(const std::chrono::steady_clock::time_point now) -> std::optional<std::chrono::steady_clock::time_point>
+	{
+		std::lock_guard drainLock(m_drainMutex);
+		std::vector<std::shared_ptr<ThreadRing>> rings;
+		{
+			std::lock_guard lock(m_ringsMutex);
+			// A ring only the logger holds belongs to a thread that has exited, it is dropped once it is empty.
+			std::erase_if(m_rings, [](const auto& ring) { return ring.use_count() == 1 && ring->Records.IsEmpty(); });
+			rings = m_rings;
+		}
+		for (const auto& ring : rings)
+		{
+			while (const auto record = ring->Records.Pop())
+				WriteRecord(*record);
+			m_dropped += ring->Dropped.exchange(0, std::memory_order_relaxed);
+		}
+		m_dropped += m_droppedWithoutRing.exchange(0, std::memory_order_relaxed);
+		// Reported at most once a window as well, a flood that fills the rings would otherwise flood the report.
+		if (m_dropped != 0 && now - m_droppedReportTime >= RateWindow)
+		{
+			WriteLine(LogLevel::Warn, now, "[Log] " + std::to_string(m_dropped) + " messages dropped, the log ring was full.");
+			m_dropped = 0;
+			m_droppedReportTime = now;
+		}
+		std::optional<std::chrono::steady_clock::time_point> nextReport;
+		const auto reportAt = [&nextReport](const std::chrono::steady_clock::time_point time)
+		{
+			if (!nextReport || time < *nextReport)
+				nextReport = time;
+		};
+		if (m_dropped != 0)
+			reportAt(m_droppedReportTime + RateWindow);
+		for (auto& [format, rate] : m_rates)
+		{
+			if (now - rate.WindowStart >= RateWindow)
+				WriteSuppressed(format, rate, now);
+			else if (rate.Suppressed != 0)
+				reportAt(rate.WindowStart + RateWindow);
+		}
+		std::cout.flush();
+		std::cerr.flush();
+		return nextReport;
+	}
+
+	void WriteSuppressed(const char* format, RateState& rate, const std::chrono::steady_clock::time_point now)
+	{
+		if (rate.Suppressed == 0)
+			return;
+		WriteLine(rate.Level, now, "[Log] " + std::to_string(rate.Suppressed) + " more of: " + format);
+		rate.Suppressed = 0;
+	}
+
+	void WriteRecord(const LogRecord& record)
+	{
+		auto& rate = m_rates[record.Format];
+		if (record.Time - rate.WindowStart >= RateWindow)
+		{
+			WriteSuppressed(record.Format, rate, record.Time);
+			rate = { .WindowStart = record.Time, .Level = record.Level };
+		}
+		if (++rate.Count > RateLimit)
+		{
+			++rate.Suppressed;
+			return;
+		}
+		WriteLine(record.Level, record.Time, record.ToString());
+	}
+
+	void WriteLine(const LogLevel level, const std::chrono::steady_clock::time_point time, const std::string& text)
+	{
+		const auto uptime = std::chrono::duration_cast<std::chrono::milliseconds>(time - m_startTime).count();
+		auto& stream = level >= LogLevel::Warn ? std::cerr : std::cout;
+		stream << '+' << uptime / 1000 << '.' << (uptime % 1000) / 100 << (uptime % 100) / 10 << uptime % 10 << "s " << text << '\n';
+	}
+};
+
+// get global logger instance
+inline Logger& GetLoggerInstance()
+{
+	static Logger instance;
+	return instance;
+}
+
+template<LogLevel Level_v, std::size_t Size_v, typename... Args_t>
+void Log(const char(&format)[Size_v], const Args_t&... args) noexcept
+{
+	if constexpr (Level_v >= MinLogLevel)
+		GetLoggerInstance().Write(Level_v, format, args...);
+}
+
+template<std::size_t Size_v, typename... Args_t>
+void LogDebug(const char(&format)[Size_v], const Args_t&... args) noexcept { Log<LogLevel::Debug>(format, args...); }
+
+template<std::size_t Size_v, typename... Args_t>
+void LogInfo(const char(&format)[Size_v], const Args_t&... args) noexcept { Log<LogLevel::Info>(format, args...); }
+
+template<std::size_t Size_v, typename... Args_t>
+void LogWarn(const char(&format)[Size_v], const Args_t&... args) noexcept { Log<LogLevel::Warn>(format, args...); }
+
+template<std::size_t Size_v, typename... Args_t>
+void LogError(const char(&format)[Size_v], const Args_t&... args) noexcept { Log<LogLevel::Error>(format, args...); }
@@ -0,0 +1,290 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "ClientFunctionality.h"
+#include "ClientMetrics.h"
+#include "Heartbeat.h"
+#include "InputLatency.h"
+#include "Logger.h"
+#include "ReconnectManager.h"
+#include "TlsClientContext.h"
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+using tcp = asio::ip::tcp;
+
+/**
+ * \brief	Builds a metrics page in the Prometheus text exposition format (version 0.0.4).
+ * \remarks	Label values are the client's own names and numbers, they are not escaped.
+ */
+class PrometheusText
+{
+	std::string m_text;
+public:
+	/**
+	 * \brief	Starts a metric family, its samples follow.
+	 */
+	void Family(const std::string_view name, const std::string_view type, const std::string_view help)
+	{
+		m_text.append("# HELP ").append(name).append(" ").append(help).append("\n");
+		m_text.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+	}
+
+	/**
+	 * \brief	Adds a sample, 'labels' is the list between the braces (e.g. <c>format="text"</c>) or empty.
+	 */
+	void Sample(const std::string_view name, const std::string_view labels, const uint64_t value)
+	{
+		std::array<char, 24> digits{};
+		const auto converted = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+		AppendSample(name, labels, { digits.data(), static_cast<std::size_t>(converted.ptr - digits.data()) });
+	}
+
+	void Sample(const std::string_view name, const std::string_view labels, const double value)
+	{
+		std::array<char, 32> digits{};
+		const auto converted = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+		AppendSample(name, labels, { digits.data(), static_cast<std::size_t>(converted.ptr - digits.data()) });
+	}
+
+	void Sample(const std::string_view name, const std::string_view labels, const std::chrono::nanoseconds value)
+	{
+		Sample(name, labels, std::chrono::duration<double>{ value }.count());
+	}
+
+	/**
+	 * \brief	Adds the samples of a summary of the durations, in seconds: the quantiles, the sum and the count.
+	 */
+	void Summary(const std::string_view name, const std::string_view labels, const LatencyHistogram& histogram)
+	{
+		const std::string separator{ labels.empty() ? "" : "," };
+		for (const auto& [quantile, label] : { std::pair{ 0.5, "0.5" }, std::pair{ 0.9, "0.9" }, std::pair{ 0.99, "0.99" }, std::pair{ 0.999, "0.999" } })
+			Sample(name, std::string{ labels } + separator + "quantile=\"" + label + "\"", histogram.GetPercentile(quantile));
+		Sample(std::string{ name } + "_sum", labels, histogram.GetTotal());
+		Sample(std::string{ name } + "_count", labels, histogram.GetCount());
+	}
+
+	[[nodiscard]] auto Take() noexcept -> std::string
+	{
+		return std::move(m_text);
+	}
+private:
+	void AppendSample(const std::string_view name, const std::string_view labels, const std::string_view value)
+	{
+		m_text.append(name);
+		if (!labels.empty())
+			m_text.append("{").append(labels).append("}");
+		m_text.append(" ").append(value).append("\n");
+	}
+};
+
+/**
+ * \brief	The client's metrics as a Prometheus text page: the message, command and action counters, the translator tick duration,
+ *	the input latency stages, the connection, TLS and heartbeat counters, the queue depths, and the CPU time of the client's threads.
+ *	The actions are labelled with 'mappingKeycodes', the keycode of each mapping index.
+ * \remarks	Every value is read with relaxed loads, so the page is not one snapshot, and reading it does not stall the client thread.
+ */
+inline auto FormatClientMetrics(const std::span<const int32_t> mappingKeycodes) -> std::string
+{
+	static constexpr std::array<std::string_view, ClientMetrics::TransitionCount> TransitionNames{ "reset", "down", "repeat", "up" };
+	const auto micros = [](const std::atomic<uint64_t>& value) { return std::chrono::nanoseconds{ std::chrono::microseconds{ value.load(std::memory_order_relaxed) } }; };
+	const auto count = [](const std::atomic<uint64_t>& value) { return value.load(std::memory_order_relaxed); };
+	const auto label = [](const std::string_view name, const std::string_view value) { return std::string{ name } + "=\"" + std::string{ value } + "\""; };
+
+	PrometheusText page;
+	const auto& metrics = GetClientMetricsInstance();
+
+	page.Family("arc_client_messages_received_total", "counter", "Frames received from the relay, by format.");
+	for (std::size_t i{}; i < FrameFormatNames.size(); ++i)
+		page.Sample("arc_client_messages_received_total", label("format", FrameFormatNames[i]), count(metrics.MessagesReceived[i]));
+	page.Family("arc_client_messages_parsed_total", "counter", "Frames decoded and handled.");
+	page.Sample("arc_client_messages_parsed_total", "", count(metrics.MessagesParsed));
+	page.Family("arc_client_messages_rejected_total", "counter", "Frames not acted on, by reason.");
+	for (std::size_t i{}; i < RejectReasonNames.size(); ++i)
+		page.Sample("arc_client_messages_rejected_total", label("reason", RejectReasonNames[i]), count(metrics.MessagesRejected[i]));
+
+	page.Family("arc_client_commands_total", "counter", "Commands received from trusted clients, by command and state.");
+	for (const auto& entry : commandLookup.GetSlots())
+	{
+		if (entry.Name.empty() || entry.Keycode < 0 || static_cast<std::size_t>(entry.Keycode) >= ClientMetrics::CommandKeycodeCount)
+			continue;
+		const auto keycode = static_cast<std::size_t>(entry.Keycode);
+		page.Sample("arc_client_commands_total", label("command", entry.Name) + ",state=\"keydown\"", count(metrics.CommandsDown[keycode]));
+		page.Sample("arc_client_commands_total", label("command", entry.Name) + ",state=\"keyup\"", count(metrics.CommandsUp[keycode]));
+	}
+
+	page.Family("arc_client_actions_total", "counter", "Mapping transitions performed by the translator, by mapping (index and keycode) and transition.");
+	for (std::size_t i{}; i < mappingKeycodes.size() && i <= ClientMetrics::MaxMappings; ++i)
+	{
+		const auto mappingLabels = i < ClientMetrics::MaxMappings
+			? label("mapping", std::to_string(i)) + "," + label("keycode", std::to_string(mappingKeycodes[i]))
+			: label("mapping", "other") + "," + label("keycode", "");
+		for (std::size_t t{}; t < TransitionNames.size(); ++t)
+			page.Sample("arc_client_actions_total", mappingLabels + "," + label("transition", TransitionNames[t]), count(metrics.Actions[i][t]));
+	}
+
+	page.Family("arc_client_translator_tick_duration_seconds", "summary", "Translator tick, from its clock read to the injected input submitted.");
+	page.Summary("arc_client_translator_tick_duration_seconds", "", metrics.TickDuration);
+	page.Family("arc_client_input_latency_seconds", "summary", "Command to injected input latency, by stage.");
+	for (std::size_t i{}; i < LatencyStageNames.size(); ++i)
+		page.Summary("arc_client_input_latency_seconds", label("stage", LatencyStageNames[i]), GetInputLatencyInstance().GetHistogram(static_cast<LatencyStage>(i)));
+
+	const auto& reconnects = GetReconnectMetricsInstance();
+	page.Family("arc_client_connects_total", "counter", "Connections registered with the relay.");
+	page.Sample("arc_client_connects_total", "", count(reconnects.Connects));
+	page.Family("arc_client_reconnects_total", "counter", "Connections registered after a lost one.");
+	page.Sample("arc_client_reconnects_total", "", count(reconnects.Reconnects));
+	page.Family("arc_client_failed_connect_attempts_total", "counter", "Connection attempts that failed.");
+	page.Sample("arc_client_failed_connect_attempts_total", "", count(reconnects.FailedAttempts));
+	page.Family("arc_client_reconnect_duration_seconds", "gauge", "Time from a lost connection to the next registered one.");
+	page.Sample("arc_client_reconnect_duration_seconds", "stat=\"last\"", micros(reconnects.LastReconnectMicros));
+	page.Sample("arc_client_reconnect_duration_seconds", "stat=\"max\"", micros(reconnects.MaxReconnectMicros));
+
+	const auto& tls = GetTlsHandshakeMetricsInstance();
+	page.Family("arc_client_tls_handshakes_total", "counter", "TLS handshakes, full or resumed.");
+	page.Sample("arc_client_tls_handshakes_total", "kind=\"full\"", count(tls.FullHandshakes));
+	page.Sample("arc_client_tls_handshakes_total", "kind=\"resumed\"", count(tls.ResumedHandshakes));
+	page.Family("arc_client_tls_handshake_seconds_total", "counter", "Time spent in TLS handshakes, full or resumed.");
+	page.Sample("arc_client_tls_handshake_seconds_total", "kind=\"full\"", micros(tls.TotalFullHandshakeMicros));
+	page.Sample("arc_client_tls_handshake_seconds_total", "kind=\"resumed\"", micros(tls.TotalResumedHandshakeMicros));
+
+	const auto& heartbeat = GetHeartbeatMetricsInstance();
+	page.Family("arc_client_pings_sent_total", "counter", "Heartbeat pings sent.");
+	page.Sample("arc_client_pings_sent_total", "", count(heartbeat.PingsSent));
+	page.Family("arc_client_pongs_received_total", "counter", "Heartbeat pongs received.");
+	page.Sample("arc_client_pongs_received_total", "", count(heartbeat.PongsReceived));
+	page.Family("arc_client_missed_pongs_total", "counter", "Heartbeat pings not answered before the next one.");
+	page.Sample("arc_client_missed_pongs_total", "", count(heartbeat.MissedPongs));
+	page.Family("arc_client_dead_connections_total", "counter", "Connections closed for missing pongs.");
+	page.Sample("arc_client_dead_connections_total", "", count(heartbeat.DeadConnections));
+	page.Family("arc_client_rtt_seconds", "gauge", "Heartbeat round trip time, zero until measured.");
+	page.Sample("arc_client_rtt_seconds", "stat=\"last\"", micros(heartbeat.LastRttMicros));
+	page.Sample("arc_client_rtt_seconds", "stat=\"min\"", micros(heartbeat.MinRttMicros));
+	page.Sample("arc_client_rtt_seconds", "stat=\"max\"", micros(heartbeat.MaxRttMicros));
+	page.Sample("arc_client_rtt_seconds", "stat=\"smoothed\"", micros(heartbeat.SmoothedRttMicros));
+	page.Sample("arc_client_rtt_seconds", "stat=\"variation\"", micros(heartbeat.RttVariationMicros));
+
+	page.Family("arc_client_queue_depth", "gauge", "Entries waiting in the client's queues.");
+	page.Sample("arc_client_queue_depth", "queue=\"log\"", static_cast<uint64_t>(GetLoggerInstance().GetQueuedCount()));
+
+	page.Family("arc_client_thread_cpu_seconds_total", "counter", "CPU time of the client's threads.");
+	GetThreadCpuTimesInstance().ForEach([&](const std::string& name, const std::chrono::nanoseconds cpuTime)
+		{
+			page.Sample("arc_client_thread_cpu_seconds_total", label("thread", name), cpuTime);
+		});
+	if (const auto processCpuTime = ThreadCpuTimes::GetProcessCpuTime())
+	{
+		page.Family("process_cpu_seconds_total", "counter", "CPU time of the process, all threads.");
+		page.Sample("process_cpu_seconds_total", "", *processCpuTime);
+	}
+	return page.Take();
+}
+
+/**
+ * \brief	Serves FormatClientMetrics(...) at http://127.0.0.1:port/metrics, for a local Prometheus scraper, on a thread of its own.
+ * \remarks	Bound to the loopback address only, it is not reachable from other hosts. One request per connection, a scrape is rare,
+ *	and the page is built on the server's thread, so the client thread only pays for its counter increments.
+ *	If the port cannot be bound, the error is logged and nothing is served.
+ */
+class MetricsServer
+{
+	static constexpr std::chrono::seconds RequestTimeout{ 5 };
+
+	asio::io_context m_ioc{ 1 };
+	tcp::acceptor m_acceptor{ m_ioc };
+	// The keycode of each mapping index, for the action labels. Not changed after construction, so the server's thread reads it without a lock.
+	const std::vector<int32_t> m_mappingKeycodes;
+	std::thread m_thread;
+public:
+	MetricsServer(const uint16_t port, std::vector<int32_t> mappingKeycodes) : m_mappingKeycodes(std::move(mappingKeycodes))
+	{
+		const tcp::endpoint endpoint{ asio::ip::address_v4::loopback(), port };
+		boost::system::error_code ec;
+		m_acceptor.open(endpoint.protocol(), ec);
+		if (!ec)
+			m_acceptor.bind(endpoint, ec);
+		if (!ec)
+			m_acceptor.listen(asio::socket_base::max_listen_connections, ec);
+		if (ec) {
+			LogError("[Metrics] Could not listen on 127.0.0.1:{}: {}", port, ec.message());
+			return;
+		}
+
+		LogInfo("[Metrics] Serving http://127.0.0.1:{}/metrics", port);
+		asio::co_spawn(m_ioc, AcceptConnections(), asio::detached);
+		m_thread = std::thread([this]()
+			{
+				const ThreadCpuTimes::Registration cpuRegistration(GetThreadCpuTimesInstance(), "metrics");
+				m_ioc.run();
+			});
+	}
+	MetricsServer(const MetricsServer&) = delete;
+	auto operator=(const MetricsServer&) -> MetricsServer & = delete;
+	~MetricsServer()
+	{
+		m_ioc.stop();
+		if (m_thread.joinable())
+			m_thread.join();
+	}
+private:
+	auto AcceptConnections() -> asio::awaitable<void>
+	{
+		while (true)
+		{
+			boost::system::error_code ec;
+			auto socket = co_await m_acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+			if (ec == asio::error::operation_aborted)
+				co_return;
+			if (ec) {
+				LogWarn("[Metrics] Accept failed: {}", ec.message());
+				continue;
+			}
+			asio::co_spawn(m_ioc, ServeRequest(std::move(socket)), asio::detached);
+		}
+	}
+
+	auto ServeRequest(tcp::socket socket) -> asio::awaitable<void>
+	{
+		beast::tcp_stream stream(std::move(socket));
+		beast::flat_buffer buffer;
+		http::request<http::empty_body> request;
+		boost::system::error_code ec;
+		stream.expires_after(RequestTimeout);
+		co_await http::async_read(stream, buffer, request, asio::redirect_error(asio::use_awaitable, ec));
+		if (ec)
+			co_return;
+
+		http::response<http::string_body> response;
+		response.version(request.version());
+		response.keep_alive(false);
+		if (request.target() != "/metrics") {
+			response.result(http::status::not_found);
+			response.set(http::field::content_type, "text/plain");
+			response.body() = "Not found, the metrics are at /metrics.\n";
+		}
+		else if (request.method() != http::verb::get) {
+			response.result(http::status::method_not_allowed);
+			response.set(http::field::allow, "GET");
+		}
+		else {
+			response.result(http::status::ok);
+			response.set(http::field::content_type, "text/plain; version=0.0.4; charset=utf-8");
+			response.body() = FormatClientMetrics(m_mappingKeycodes);
+		}
+		response.prepare_payload();
+		co_await http::async_write(stream, response, asio::redirect_error(asio::use_awaitable, ec));
+		stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+	}
+};
@@ -0,0 +1,179 @@
+#pragma once
+#include "StreamToActionTranslator.h"
+#include "InputSink.h"
+#include <cmath>
+#include <chrono>
+#include <optional>
+
+/**
+ * \brief	Pointer speed as a function of how long the pointer has been moving: starts at BaseSpeed and ramps to MaxSpeed over RampTime.
+ *	Exponent shapes the ramp, 1 is linear, larger values stay slow for longer (finer control for short holds).
+ */
+struct MotionCurve
+{
+	// Pixels per second.
+	double BaseSpeed{ 600.0 };
+	double MaxSpeed{ 1600.0 };
+	sds::Nanos_t RampTime{ std::chrono::milliseconds{ 500 } };
+	double Exponent{ 2.0 };
+
+	/**
+	 * \brief	Distance travelled (pixels) from the start of motion to 'heldFor', the exact integral of the speed curve.
+	 * \remarks	Integrating exactly, rather than summing speed * tick, is what makes the distance independent of when and how often the motion is updated.
+	 */
+	[[nodiscard]] auto GetDistance(const sds::Nanos_t heldFor) const noexcept -> double
+	{
+		using Seconds_t = std::chrono::duration<double>;
+		const double t = Seconds_t{ heldFor }.count();
+		const double ramp = Seconds_t{ RampTime }.count();
+		const double extra = MaxSpeed - BaseSpeed;
+		if (ramp <= 0.0)
+			return MaxSpeed * t;
+		if (t < ramp)
+			return BaseSpeed * t + extra * ramp / (Exponent + 1.0) * std::pow(t / ramp, Exponent + 1.0);
+		return BaseSpeed * t + extra * (ramp / (Exponent + 1.0) + (t - ramp));
+	}
+};
+
+/**
+ * \brief	Integrates pointer velocity over real elapsed time, and emits the whole-pixel movement as one coalesced move per output period.
+ * \remarks	The held direction is the sum of the directions set with <c>SetDirectionHeld(...)</c>, normalized, so diagonal speed matches straight speed.
+ *	Analog input (a velocity with a time-to-live, and displacements) is added on top of the held directions.
+ *	Sub-pixel remainders are kept between updates, so nothing is lost to rounding.
+ *	Not thread-safe, it is updated on the client thread, by the translator tick and by ReleaseHeldInput(...) when a connection ends.
+ */
+class PointerMotion
+{
+	MotionCurve m_curve;
+	sds::Nanos_t m_outputPeriod;
+
+	// Sum of the held direction vectors.
+	int32_t m_heldX{};
+	int32_t m_heldY{};
+	// Sub-pixel distance not yet emitted, Y positive is up.
+	double m_remainderX{};
+	double m_remainderY{};
+
+	// Analog velocity in screen pixels per second, integrated until it expires.
+	double m_velocityX{};
+	double m_velocityY{};
+	sds::TimePoint_t m_velocityExpiry{};
+
+	std::optional<sds::TimePoint_t> m_motionStart;
+	sds::TimePoint_t m_lastUpdate{};
+	sds::TimePoint_t m_nextOutput{};
+public:
+	static constexpr sds::Nanos_t DefaultOutputPeriod{ std::chrono::milliseconds{ 8 } };
+
+	explicit PointerMotion(const MotionCurve curve = {}, const sds::Nanos_t outputPeriod = DefaultOutputPeriod) noexcept
+		: m_curve(curve), m_outputPeriod(outputPeriod)
+	{
+	}
+
+	/**
+	 * \brief	Adds (held) or removes (released) a direction, in pointer units where Y positive is up. The change applies from the last Update(...).
+	 */
+	void SetDirectionHeld(const int32_t x, const int32_t y, const bool isHeld) noexcept
+	{
+		const int32_t sign = isHeld ? 1 : -1;
+		m_heldX += sign * x;
+		m_heldY += sign * y;
+		if (!IsDirectionHeld())
+			m_motionStart.reset();
+		else if (!m_motionStart)
+			m_motionStart = m_lastUpdate;
+	}
+
+	/**
+	 * \brief	Sets the analog velocity, in screen pixels per second (Y positive is down), replacing the previous one. It applies from the last Update(...)
+	 *	and expires at 'expiry', so a sender that goes silent does not leave the pointer drifting.
+	 */
+	void SetVelocity(const double vx, const double vy, const sds::TimePoint_t expiry) noexcept
+	{
+		m_velocityX = vx;
+		m_velocityY = vy;
+		m_velocityExpiry = expiry;
+	}
+
+	/**
+	 * \brief	Adds a displacement, in screen pixels (Y positive is down), emitted with the next output.
+	 */
+	void AddDisplacement(const double dx, const double dy) noexcept
+	{
+		m_remainderX += dx;
+		m_remainderY -= dy;
+	}
+
+	[[nodiscard]] bool IsMoving() const noexcept
+	{
+		return IsDirectionHeld() || IsVelocityActive();
+	}
+
+	/**
+	 * \brief	Integrates the motion up to 'now', and writes the accumulated whole-pixel move to the sink if an output period has passed.
+	 * \param sensitivity	Multiplier of the curve's speed, for the interval since the last update.
+	 */
+	void Update(const sds::TimePoint_t now, InputSink& sink, const double sensitivity = 1.0)
+	{
+		if (m_motionStart && now > m_lastUpdate)
+		{
+			const double distance = (m_curve.GetDistance(now - *m_motionStart) - m_curve.GetDistance(m_lastUpdate - *m_motionStart)) * sensitivity;
+			const double length = std::hypot(static_cast<double>(m_heldX), static_cast<double>(m_heldY));
+			m_remainderX += distance * m_heldX / length;
+			m_remainderY += distance * m_heldY / length;
+		}
+		if (IsVelocityActive() && now > m_lastUpdate)
+		{
+			using Seconds_t = std::chrono::duration<double>;
+			const double elapsed = Seconds_t{ std::min(now, m_velocityExpiry) - m_lastUpdate }.count() * sensitivity;
+			m_remainderX += m_velocityX * elapsed;
+			m_remainderY -= m_velocityY * elapsed;
+		}
+		m_lastUpdate = now;
+
+		if (now < m_nextOutput)
+			return;
+		const auto wholeX = static_cast<int32_t>(m_remainderX);
+		const auto wholeY = static_cast<int32_t>(m_remainderY);
+		if (wholeX != 0 || wholeY != 0)
+		{
+			m_remainderX -= wholeX;
+			m_remainderY -= wholeY;
+			sink.MouseMove(wholeX, -wholeY);
+			m_nextOutput = now + m_outputPeriod;
+		}
+	}
+
+	/**
+	 * \brief	Time of the next output while the pointer is moving, or of the final output after it stops, for the client's tick timer.
+	 *	Empty when there is nothing to emit.
+	 */
+	[[nodiscard]] auto GetNextDeadline() const noexcept -> std::optional<sds::TimePoint_t>
+	{
+		if (IsMoving())
+			return std::max(m_nextOutput, m_lastUpdate + m_outputPeriod);
+		if (std::abs(m_remainderX) >= 1.0 || std::abs(m_remainderY) >= 1.0)
+			return m_nextOutput;
+		return {};
+	}
+
+	void SetCurve(const MotionCurve curve) noexcept
+	{
+		m_curve = curve;
+	}
+
+	void SetOutputPeriod(const sds::Nanos_t outputPeriod) noexcept
+	{
+		m_outputPeriod = outputPeriod;
+	}
+private:
+	[[nodiscard]] bool IsDirectionHeld() const noexcept
+	{
+		return m_heldX != 0 || m_heldY != 0;
+	}
+
+	[[nodiscard]] bool IsVelocityActive() const noexcept
+	{
+		return (m_velocityX != 0.0 || m_velocityY != 0.0) && m_lastUpdate < m_velocityExpiry;
+	}
+};
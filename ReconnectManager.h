@@ -0,0 +1,395 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Logger.h"
+
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+
+/**
+ * \brief	Timing of the client's reconnects, and the time limits of each connect phase.
+ */
+struct ReconnectPolicy
+{
+	// The first retry after a lost connection is immediate, later ones wait InitialDelay, doubled each time up to MaxDelay, with jitter.
+	std::chrono::milliseconds InitialDelay{ 250 };
+	std::chrono::milliseconds MaxDelay{ 15'000 };
+	// Consecutive failed attempts before giving up, empty to retry until stopped.
+	std::optional<int> MaxAttempts;
+	std::chrono::milliseconds ResolveTimeout{ 5'000 };
+	std::chrono::milliseconds ConnectTimeout{ 5'000 };
+	std::chrono::milliseconds TlsHandshakeTimeout{ 5'000 };
+	std::chrono::milliseconds WebSocketHandshakeTimeout{ 5'000 };
+	// Happy eyeballs (RFC 8305) connection attempt delay, the next address is tried if the ones before it have not connected within this.
+	std::chrono::milliseconds ConnectionAttemptDelay{ 250 };
+	// A resolved endpoint list is re-used for this long, then resolved again. An older list is still used if the resolve fails or times out.
+	std::chrono::minutes EndpointCacheTimeToLive{ 5 };
+};
+
+/**
+ * \brief	Reconnect counters, updated with relaxed atomics so they can be read from any thread.
+ */
+struct ReconnectMetrics
+{
+	std::atomic<uint64_t> Connects{};
+	std::atomic<uint64_t> Reconnects{};
+	std::atomic<uint64_t> FailedAttempts{};
+	std::atomic<uint64_t> CachedResolves{};
+	// Time from a lost connection to the next registered one.
+	std::atomic<uint64_t> LastReconnectMicros{};
+	std::atomic<uint64_t> MaxReconnectMicros{};
+	std::atomic<uint64_t> TotalReconnectMicros{};
+
+	void RecordReconnect(const std::chrono::steady_clock::duration timeToReconnect) noexcept
+	{
+		const auto micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(timeToReconnect).count());
+		Reconnects.fetch_add(1, std::memory_order_relaxed);
+		LastReconnectMicros.store(micros, std::memory_order_relaxed);
+		TotalReconnectMicros.fetch_add(micros, std::memory_order_relaxed);
+		// Only the client thread writes, so the load then store does not lose a larger value.
+		if (micros > MaxReconnectMicros.load(std::memory_order_relaxed))
+			MaxReconnectMicros.store(micros, std::memory_order_relaxed);
+	}
+};
+
+// get global reconnect metrics instance
+inline ReconnectMetrics& GetReconnectMetricsInstance()
+{
+	static ReconnectMetrics instance;
+	return instance;
+}
+
+/**
+ * \brief	Capped exponential backoff with "equal jitter", the delay is a random duration in [d/2, d] for an exponential d,
+ *	so clients that lost their connections together do not all retry at the same instants.
+ */
+class ReconnectBackoff
+{
+	std::chrono::milliseconds m_initialDelay;
+	std::chrono::milliseconds m_maxDelay;
+	std::minstd_rand m_random{ std::random_device{}() };
+	int m_attempt{};
+public:
+	ReconnectBackoff(const std::chrono::milliseconds initialDelay, const std::chrono::milliseconds maxDelay)
+		: m_initialDelay(initialDelay), m_maxDelay(maxDelay) { }
+
+	/**
+	 * \brief	The delay before the next attempt, zero for the first one since Reset().
+	 */
+	[[nodiscard]] auto NextDelay() -> std::chrono::milliseconds
+	{
+		const auto attempt = m_attempt++;
+		if (attempt == 0)
+			return {};
+		// Doubled until the cap, the shift is bounded so it cannot overflow.
+		const auto exponential = m_initialDelay * (int64_t{ 1 } << std::min(attempt - 1, 30));
+		const auto delay = std::min<std::chrono::milliseconds>(exponential, m_maxDelay);
+		std::uniform_int_distribution<int64_t> jitter(delay.count() / 2, delay.count());
+		return std::chrono::milliseconds{ jitter(m_random) };
+	}
+
+	void Reset() noexcept
+	{
+		m_attempt = 0;
+	}
+};
+
+/**
+ * \brief	The last resolved endpoint list of a host and port, so a reconnect does not wait on DNS. Used by the client thread only.
+ */
+class EndpointCache
+{
+	std::string m_host;
+	std::string m_port;
+	std::vector<tcp::endpoint> m_endpoints;
+	std::optional<std::chrono::steady_clock::time_point> m_resolvedTime;
+public:
+	/**
+	 * \brief	The endpoints of the host and port, empty if there are none, or (when a maximum age is given) they are older than it.
+	 */
+	[[nodiscard]] auto Get(const std::string_view host, const std::string_view port, const std::optional<std::chrono::steady_clock::duration> maxAge = {}) const
+		-> std::optional<std::vector<tcp::endpoint>>
+	{
+		if (m_host != host || m_port != port || m_endpoints.empty())
+			return {};
+		if (maxAge && (!m_resolvedTime || std::chrono::steady_clock::now() - *m_resolvedTime > *maxAge))
+			return {};
+		return m_endpoints;
+	}
+
+	void Store(const std::string_view host, const std::string_view port, std::vector<tcp::endpoint> endpoints)
+	{
+		m_host = host;
+		m_port = port;
+		m_endpoints = std::move(endpoints);
+		m_resolvedTime = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * \brief	Marks the endpoints as out of date (none of them connected), the next connect resolves again. They are kept as a fallback.
+	 */
+	void Invalidate() noexcept
+	{
+		m_resolvedTime.reset();
+	}
+};
+
+// get global endpoint cache instance
+inline EndpointCache& GetEndpointCacheInstance()
+{
+	static EndpointCache instance;
+	return instance;
+}
+
+/**
+ * \brief	Runs the operation on the current executor, an empty optional if it has not completed within the timeout.
+ * \remarks	An operation that times out is not cancelled by this, it completes on its own and the result is discarded. Exceptions are rethrown.
+ */
+template<typename Value_t>
+auto AwaitWithTimeout(asio::awaitable<Value_t> operation, const std::chrono::steady_clock::duration timeout) -> asio::awaitable<std::optional<Value_t>>
+{
+	struct State
+	{
+		explicit State(const asio::any_io_executor& executor) : Timer(executor) { }
+		asio::steady_timer Timer;
+		std::optional<Value_t> Result;
+		std::exception_ptr Error;
+	};
+	const auto executor = co_await asio::this_coro::executor;
+	const auto state = std::make_shared<State>(executor);
+	state->Timer.expires_after(timeout);
+	asio::co_spawn(executor, std::move(operation), [state](const std::exception_ptr& error, Value_t value)
+		{
+			if (error)
+				state->Error = error;
+			else
+				state->Result = std::move(value);
+			state->Timer.cancel();
+		});
+	boost::system::error_code ec;
+	co_await state->Timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+	if (state->Error)
+		std::rethrow_exception(state->Error);
+	co_return std::move(state->Result);
+}
+
+/**
+ * \brief	The endpoints of the host and port, from the cache when it is fresh, otherwise resolved (within the resolve timeout) and cached.
+ *	If the resolve fails or times out, older cached endpoints are used if there are any.
+ */
+inline auto ResolveEndpoints(tcp::resolver& resolver, const std::string& host, const std::string& port, EndpointCache& cache, const ReconnectPolicy& policy)
+	-> asio::awaitable<std::vector<tcp::endpoint>>
+{
+	if (auto cached = cache.Get(host, port, policy.EndpointCacheTimeToLive)) {
+		GetReconnectMetricsInstance().CachedResolves.fetch_add(1, std::memory_order_relaxed);
+		co_return std::move(*cached);
+	}
+
+	std::exception_ptr error;
+	try {
+		const auto results = co_await AwaitWithTimeout(resolver.async_resolve(host, port, asio::use_awaitable), policy.ResolveTimeout);
+		if (results && !results->empty()) {
+			std::vector<tcp::endpoint> endpoints;
+			for (const auto& entry : *results)
+				endpoints.push_back(entry.endpoint());
+			cache.Store(host, port, endpoints);
+			co_return endpoints;
+		}
+		if (!results)
+			resolver.cancel();
+	}
+	catch (const std::exception&) {
+		error = std::current_exception();
+	}
+
+	if (auto stale = cache.Get(host, port)) {
+		LogWarn("[Reconnect] Resolving {} failed, using the endpoints resolved before.", host);
+		GetReconnectMetricsInstance().CachedResolves.fetch_add(1, std::memory_order_relaxed);
+		co_return std::move(*stale);
+	}
+	if (error)
+		std::rethrow_exception(error);
+	throw boost::system::system_error(asio::error::timed_out, "Resolve");
+}
+
+/**
+ * \brief	Orders the endpoints for connecting, alternating address families starting with the first one's (RFC 8305 section 4).
+ */
+[[nodiscard]] inline auto InterleaveAddressFamilies(const std::vector<tcp::endpoint>& endpoints) -> std::vector<tcp::endpoint>
+{
+	std::vector<tcp::endpoint> first;
+	std::vector<tcp::endpoint> other;
+	for (const auto& endpoint : endpoints)
+		(endpoint.address().is_v6() == endpoints.front().address().is_v6() ? first : other).push_back(endpoint);
+
+	std::vector<tcp::endpoint> result;
+	result.reserve(endpoints.size());
+	for (std::size_t i{}; i < std::max(first.size(), other.size()); ++i)
+	{
+		if (i < first.size())
+			result.push_back(first[i]);
+		if (i < other.size())
+			result.push_back(other[i]);
+	}
+	return result;
+}
+
+/**
+ * \brief	Happy eyeballs connect (RFC 8305): a connection attempt is started to each endpoint in turn, the next one when the attempts before
+ *	it have not connected within the attempt delay (or at once when one fails). The first to connect is used, the others are closed.
+ * \remarks	Shared with the attempts' coroutines, so it outlives a Connect(...) that is abandoned. All on one strand.
+ */
+class HappyEyeballsConnector : public std::enable_shared_from_this<HappyEyeballsConnector>
+{
+	asio::any_io_executor m_executor;
+	// Expires at the next attempt's start (or the timeout), cancelled when an attempt completes.
+	asio::steady_timer m_wake;
+	std::vector<std::unique_ptr<tcp::socket>> m_sockets;
+	std::optional<std::size_t> m_winner;
+	std::size_t m_running{};
+	boost::system::error_code m_lastError{ asio::error::host_not_found };
+	bool m_isCancelled{};
+public:
+	explicit HappyEyeballsConnector(const asio::any_io_executor& executor) : m_executor(executor), m_wake(executor) { }
+
+	/**
+	 * \brief	The connected socket, throws the last attempt's error if none connected, or timed_out if none connected within the timeout.
+	 */
+	auto Connect(const std::vector<tcp::endpoint> endpoints, const std::chrono::milliseconds attemptDelay, const std::chrono::milliseconds timeout)
+		-> asio::awaitable<tcp::socket>
+	{
+		const auto self = shared_from_this();
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		const auto ordered = InterleaveAddressFamilies(endpoints);
+		for (std::size_t i{}; i < ordered.size() && !m_winner && !m_isCancelled && std::chrono::steady_clock::now() < deadline; ++i)
+		{
+			m_sockets.push_back(std::make_unique<tcp::socket>(m_executor));
+			++m_running;
+			asio::co_spawn(m_executor, Attempt(self, i, ordered[i]), asio::detached);
+			// The next attempt starts after the delay, or when every started attempt has failed.
+			if (i + 1 < ordered.size())
+				co_await WaitUntil(std::min(std::chrono::steady_clock::now() + attemptDelay, deadline), [this]() { return m_winner || m_running == 0; });
+		}
+		co_await WaitUntil(deadline, [this]() { return m_winner || m_running == 0; });
+
+		const auto winner = m_winner;
+		Cancel();
+		if (!winner)
+			throw boost::system::system_error(m_running != 0 ? asio::error::timed_out : m_lastError, "Connect");
+		co_return std::move(*m_sockets[*winner]);
+	}
+
+	/**
+	 * \brief	Closes the attempts still running, Connect(...) then completes with an error (unless one had already connected).
+	 */
+	void Cancel()
+	{
+		m_isCancelled = true;
+		for (std::size_t i{}; i < m_sockets.size(); ++i)
+		{
+			if (i != m_winner)
+			{
+				boost::system::error_code ec;
+				m_sockets[i]->close(ec);
+			}
+		}
+		m_wake.cancel();
+	}
+private:
+	static auto Attempt(const std::shared_ptr<HappyEyeballsConnector> self, const std::size_t index, const tcp::endpoint endpoint) -> asio::awaitable<void>
+	{
+		boost::system::error_code ec;
+		co_await self->m_sockets[index]->async_connect(endpoint, asio::redirect_error(asio::use_awaitable, ec));
+		--self->m_running;
+		if (!ec && !self->m_winner && !self->m_isCancelled)
+			self->m_winner = index;
+		else if (ec && ec != asio::error::operation_aborted)
+			self->m_lastError = ec;
+		self->m_wake.cancel();
+	}
+
+	auto WaitUntil(const std::chrono::steady_clock::time_point until, const auto isDone) -> asio::awaitable<void>
+	{
+		while (!isDone() && !m_isCancelled && std::chrono::steady_clock::now() < until)
+		{
+			boost::system::error_code ec;
+			m_wake.expires_at(until);
+			co_await m_wake.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+		}
+	}
+};
+
+/**
+ * \brief	Tracks the client's connection outages, for the reconnect delays and the time-to-reconnect metrics. Used by the client thread only.
+ */
+class ReconnectManager
+{
+	ReconnectPolicy m_policy;
+	ReconnectBackoff m_backoff;
+	// When the connection was lost, empty while connected and before the first connection.
+	std::optional<std::chrono::steady_clock::time_point> m_lostTime;
+	int m_failedAttempts{};
+public:
+	explicit ReconnectManager(const ReconnectPolicy& policy) : m_policy(policy), m_backoff(policy.InitialDelay, policy.MaxDelay) { }
+
+	[[nodiscard]] auto GetPolicy() const noexcept -> const ReconnectPolicy&
+	{
+		return m_policy;
+	}
+
+	/**
+	 * \brief	Called when a connection is registered.
+	 */
+	void OnConnected()
+	{
+		auto& metrics = GetReconnectMetricsInstance();
+		metrics.Connects.fetch_add(1, std::memory_order_relaxed);
+		if (m_lostTime)
+		{
+			const auto timeToReconnect = std::chrono::steady_clock::now() - *m_lostTime;
+			metrics.RecordReconnect(timeToReconnect);
+			LogInfo("[Reconnect] Reconnected {} ms after the connection was lost, {} failed attempts.",
+				std::chrono::duration_cast<std::chrono::milliseconds>(timeToReconnect).count(), m_failedAttempts);
+		}
+		m_lostTime.reset();
+		m_failedAttempts = 0;
+		m_backoff.Reset();
+	}
+
+	/**
+	 * \brief	Called when a connection ends (wasConnected), or an attempt fails, and the client is not stopping.
+	 * \return	The delay before the next attempt, empty to give up (MaxAttempts consecutive failures).
+	 */
+	[[nodiscard]] auto OnDisconnected(const bool wasConnected) -> std::optional<std::chrono::milliseconds>
+	{
+		if (wasConnected)
+		{
+			m_lostTime = std::chrono::steady_clock::now();
+		}
+		else
+		{
+			++m_failedAttempts;
+			GetReconnectMetricsInstance().FailedAttempts.fetch_add(1, std::memory_order_relaxed);
+			if (m_policy.MaxAttempts && m_failedAttempts >= *m_policy.MaxAttempts)
+				return {};
+		}
+		return m_backoff.NextDelay();
+	}
+
+	/**
+	 * \brief	Failed attempts since the last connection.
+	 */
+	[[nodiscard]] auto GetFailedAttempts() const noexcept -> int
+	{
+		return m_failedAttempts;
+	}
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include "StreamToActionTranslator.h"
+#include "InputSink.h"
+#include <cmath>
+#include <chrono>
+#include <optional>
+
+/**
+ * \brief	Scroll speed while a scroll direction is held, and the momentum after it is released.
+ *	After release the speed decays exponentially at the Friction rate, until it is below StopSpeed.
+ */
+struct ScrollCurve
+{
+	// Wheel notches per second.
+	double Speed{ 8.0 };
+	// Per second, the momentum speed is multiplied by e^(-Friction * t).
+	double Friction{ 5.0 };
+	// Wheel notches per second, below which the momentum stops.
+	double StopSpeed{ 0.25 };
+};
+
+/**
+ * \brief	Integrates scrolling over real elapsed time in high-resolution wheel units (WHEEL_DELTA is 120 per notch),
+ *	and emits the whole units as one wheel event per output period.
+ * \remarks	Fractional units are kept between updates, so the emitted total follows the integrated scroll exactly.
+ *	Holding a direction scrolls at a constant speed, and the scroll coasts to a stop after release.
+ *	Not thread-safe, it is updated on the client thread, by the translator tick and by ReleaseHeldInput(...) when a connection ends.
+ */
+class ScrollMotion
+{
+	ScrollCurve m_curve;
+	sds::Nanos_t m_outputPeriod;
+
+	// Sum of the held directions, positive is away from the user.
+	int32_t m_held{};
+	// Notches per second, the held speed or the decaying momentum.
+	double m_velocity{};
+	// Wheel units not yet emitted.
+	double m_remainder{};
+
+	sds::TimePoint_t m_lastUpdate{};
+	sds::TimePoint_t m_nextOutput{};
+public:
+	static constexpr double UnitsPerNotch{ 120.0 };
+	static constexpr sds::Nanos_t DefaultOutputPeriod{ std::chrono::milliseconds{ 8 } };
+
+	explicit ScrollMotion(const ScrollCurve curve = {}, const sds::Nanos_t outputPeriod = DefaultOutputPeriod) noexcept
+		: m_curve(curve), m_outputPeriod(outputPeriod)
+	{
+	}
+
+	/**
+	 * \brief	Adds (held) or removes (released) a scroll direction, +1 is away from the user. The change applies from the last Update(...).
+	 */
+	void SetDirectionHeld(const int32_t direction, const bool isHeld) noexcept
+	{
+		m_held += isHeld ? direction : -direction;
+		if (m_held != 0)
+			m_velocity = m_held * m_curve.Speed;
+	}
+
+	/**
+	 * \brief	Adds a scroll amount in (possibly fractional) notches, emitted with the next output.
+	 */
+	void AddScroll(const double notches) noexcept
+	{
+		m_remainder += notches * UnitsPerNotch;
+	}
+
+	[[nodiscard]] bool IsScrolling() const noexcept
+	{
+		return m_velocity != 0.0;
+	}
+
+	/**
+	 * \brief	Integrates the scroll up to 'now', and writes the accumulated whole wheel units to the sink if an output period has passed.
+	 */
+	void Update(const sds::TimePoint_t now, InputSink& sink)
+	{
+		if (IsScrolling() && now > m_lastUpdate)
+		{
+			using Seconds_t = std::chrono::duration<double>;
+			const double elapsed = Seconds_t{ now - m_lastUpdate }.count();
+			if (m_held != 0 || m_curve.Friction <= 0.0)
+			{
+				m_remainder += m_velocity * elapsed * UnitsPerNotch;
+			}
+			else
+			{
+				// Exact integral of the exponentially decaying momentum over the interval.
+				const double decay = std::exp(-m_curve.Friction * elapsed);
+				m_remainder += m_velocity * (1.0 - decay) / m_curve.Friction * UnitsPerNotch;
+				m_velocity *= decay;
+				if (std::abs(m_velocity) < m_curve.StopSpeed)
+					m_velocity = {};
+			}
+		}
+		m_lastUpdate = now;
+
+		if (now < m_nextOutput)
+			return;
+		if (const auto whole = static_cast<int32_t>(m_remainder); whole != 0)
+		{
+			m_remainder -= whole;
+			sink.Wheel(whole);
+			m_nextOutput = now + m_outputPeriod;
+		}
+	}
+
+	/**
+	 * \brief	Time of the next output while scrolling, or of the final output after it stops, for the client's tick timer.
+	 *	Empty when there is nothing to emit.
+	 */
+	[[nodiscard]] auto GetNextDeadline() const noexcept -> std::optional<sds::TimePoint_t>
+	{
+		if (IsScrolling())
+			return std::max(m_nextOutput, m_lastUpdate + m_outputPeriod);
+		if (std::abs(m_remainder) >= 1.0)
+			return m_nextOutput;
+		return {};
+	}
+
+	void SetCurve(const ScrollCurve curve) noexcept
+	{
+		m_curve = curve;
+	}
+};
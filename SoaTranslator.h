@@ -0,0 +1,340 @@
+/*
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute this software, either in source code form or as a compiled binary, for any purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this software dedicate any and all copyright interest in the software to the public domain. We make this dedication for the benefit of the public at large and to the detriment of our heirs and successors. We intend this dedication to be an overt act of relinquishment in perpetuity of all present and future rights to this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to https://unlicense.org
+*/
+#pragma once
+#include "StreamToActionTranslator.h"
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SDS_DEADLINE_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SDS_DEADLINE_SCAN_SSE2 1
+#endif
+
+namespace sds
+{
+	// Deadlines are stored as nanosecond counts since the clock epoch, this value means "no deadline".
+	inline constexpr int64_t NoDeadline{ std::numeric_limits<int64_t>::max() };
+
+	/**
+	 * \brief	Sets bit N of the elapsed mask for every N where either deadline has passed (deadline < now), clears it otherwise.
+	 * \remarks	Uses AVX2 or SSE2 when enabled for the build, with a scalar fallback. The comparison is done as the sign of (deadline - now),
+	 *	which is exact for any deadline produced from the clock and for NoDeadline.
+	 *	<p><b>Pre:</b> both deadline spans are the same size, padded to a multiple of 4 with NoDeadline, and the mask has a word for every 64 deadlines.</p>
+	 */
+	inline void ScanElapsedDeadlines(const std::span<const int64_t> firstDeadlines, const std::span<const int64_t> secondDeadlines, const int64_t now, const std::span<uint64_t> elapsedMask) noexcept
+	{
+		assert(firstDeadlines.size() == secondDeadlines.size());
+		assert(firstDeadlines.size() % 4 == 0);
+		assert(elapsedMask.size() * 64 >= firstDeadlines.size());
+
+		std::ranges::fill(elapsedMask, uint64_t{});
+		std::size_t i{};
+#if defined(SDS_DEADLINE_SCAN_AVX2)
+		const __m256i nowVec = _mm256_set1_epi64x(now);
+		for (; i + 4 <= firstDeadlines.size(); i += 4)
+		{
+			const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(firstDeadlines.data() + i));
+			const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secondDeadlines.data() + i));
+			const __m256i signs = _mm256_or_si256(_mm256_sub_epi64(first, nowVec), _mm256_sub_epi64(second, nowVec));
+			const auto bits = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(signs)));
+			elapsedMask[i / 64] |= bits << (i % 64);
+		}
+#elif defined(SDS_DEADLINE_SCAN_SSE2)
+		const __m128i nowVec = _mm_set1_epi64x(now);
+		for (; i + 2 <= firstDeadlines.size(); i += 2)
+		{
+			const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(firstDeadlines.data() + i));
+			const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secondDeadlines.data() + i));
+			const __m128i signs = _mm_or_si128(_mm_sub_epi64(first, nowVec), _mm_sub_epi64(second, nowVec));
+			const auto bits = static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(signs)));
+			elapsedMask[i / 64] |= bits << (i % 64);
+		}
+#endif
+		for (; i < firstDeadlines.size(); ++i)
+		{
+			const bool isElapsed = ((firstDeadlines[i] - now) | (secondDeadlines[i] - now)) < 0;
+			elapsedMask[i / 64] |= static_cast<uint64_t>(isElapsed) << (i % 64);
+		}
+	}
+
+	/**
+	 * \brief	Structure-of-arrays storage mode of the Translator, for very large mapping counts. Produces the same TransitionRecords as
+	 *	<c>Translator::GetUpdatedTransitions(...)</c> for the same mappings and state updates.
+	 * \remarks	The mapping states, repeat deadlines and first-repeat deadlines live in separate contiguous arrays. A deadline is only stored
+	 *	while it is relevant to the mapping's current state, so a single vectorized scan against one "now" snapshot finds every timer driven
+	 *	transition. Key driven transitions are found from the down keys and the set of held mappings, so a tick does not visit idle mappings.
+	 *	Closure-free dispatch only. Not copyable. Is movable.
+	 *	<p>An invariant exists such that: <b>There must be only one mapping per virtual keycode.</b></p>
+	 */
+	class SoaTranslator
+	{
+		using MappingVector_t = SmallVector_t<MappingContainer>;
+		static constexpr std::size_t ScanLanes{ 4 };
+
+		std::shared_ptr<MappingVector_t> m_mappings;
+		std::shared_ptr<const VirtualKeyIndex> m_keyIndex;
+
+		SmallVector_t<ActionState> m_states;
+		// Deadline of the next repeat while repeating, or of the reset while up. Padded to a multiple of ScanLanes with NoDeadline.
+		SmallVector_t<int64_t> m_repeatDeadlines;
+		// Deadline of the first repeat while down. Padded to a multiple of ScanLanes with NoDeadline.
+		SmallVector_t<int64_t> m_firstRepeatDeadlines;
+		// Time of the last key-down or repeat, the reset delay after key-up runs from this, as it does for MappingStateTracker::LastSentTime.
+		SmallVector_t<int64_t> m_lastSentTimes;
+		// Time of the key-down, the delay in between repeats of a RepeatType::Accelerating mapping ramps from this.
+		SmallVector_t<int64_t> m_downTimes;
+		SmallVector_t<int64_t> m_repeatDelays;
+		SmallVector_t<int64_t> m_firstRepeatDelays;
+
+		// One bit per mapping, set while the mapping is down or repeating.
+		SmallVector_t<uint64_t> m_heldMask;
+		// Scratch for the per tick candidate mappings, kept to avoid allocating.
+		SmallVector_t<uint64_t> m_candidateMask;
+	public:
+		SoaTranslator() = delete;
+		SoaTranslator(const SoaTranslator& other) = delete;
+		auto operator=(const SoaTranslator& other) -> SoaTranslator & = delete;
+
+		SoaTranslator(SoaTranslator&& other) = default;
+		auto operator=(SoaTranslator&& other) -> SoaTranslator & = default;
+		~SoaTranslator() = default;
+
+		/**
+		 * \brief Mapping Vector Ctor, may throw on more than one mapping per VK, or more mappings than Index_t can address.
+		 * \exception std::runtime_error on more than one mapping per VK, or too many mappings.
+		 */
+		explicit SoaTranslator(MappingRange_c auto&& keyMappings)
+			: m_mappings(std::make_shared<MappingVector_t>(std::forward<decltype(keyMappings)>(keyMappings)))
+		{
+			if (!AreMappingsUniquePerVk(*m_mappings) || !AreMappingVksNonZero(*m_mappings))
+				throw std::runtime_error("Exception: More than 1 mapping per VK!");
+			if (m_mappings->size() > std::numeric_limits<Index_t>::max())
+				throw std::runtime_error("Exception: Too many mappings for Index_t!");
+
+			m_keyIndex = std::make_shared<const VirtualKeyIndex>(*m_mappings);
+			const auto mappingCount = m_mappings->size();
+			const auto paddedCount = (mappingCount + ScanLanes - 1) / ScanLanes * ScanLanes;
+			const auto maskWords = (paddedCount + 63) / 64;
+
+			m_states.assign(mappingCount, ActionState::Init);
+			m_lastSentTimes.assign(mappingCount, 0);
+			m_downTimes.assign(mappingCount, 0);
+			m_repeatDeadlines.assign(paddedCount, NoDeadline);
+			m_firstRepeatDeadlines.assign(paddedCount, NoDeadline);
+			m_heldMask.assign(maskWords, 0);
+			m_candidateMask.assign(maskWords, 0);
+			m_repeatDelays.reserve(mappingCount);
+			m_firstRepeatDelays.reserve(mappingCount);
+
+			for (std::size_t i{}; i < mappingCount; ++i)
+			{
+				const auto& mapping = (*m_mappings)[i];
+				m_firstRepeatDelays.push_back(mapping.DelayBeforeFirstRepeat.value_or(DelayTimer::DefaultKeyRepeatDelay).count());
+				m_repeatDelays.push_back(mapping.BetweenRepeatDelay.value_or(DelayTimer::DefaultKeyRepeatDelay).count());
+			}
+		}
+	public:
+		/**
+		 * \brief	Fills a caller owned pack with TransitionRecords for the state update, the pack is cleared first. All deadlines are compared against the one <c>now</c>.
+		 * \param stateUpdate Range of the down virtual keycodes, SmallVector_t or KeySet.
+		 */
+		void GetUpdatedTransitions(const std::ranges::range auto& stateUpdate, TransitionPack& transitions, const TimePoint_t now = Clock_t::now())
+		{
+			transitions.Clear();
+			const int64_t nowCount = now.time_since_epoch().count();
+
+			// Timer driven candidates, plus every held mapping (may go up), plus initial mappings with a down key.
+			ScanElapsedDeadlines(m_firstRepeatDeadlines, m_repeatDeadlines, nowCount, m_candidateMask);
+			for (std::size_t w{}; w < m_candidateMask.size(); ++w)
+				m_candidateMask[w] |= m_heldMask[w];
+			for (const auto vk : stateUpdate)
+			{
+				const auto index = m_keyIndex->Find(vk);
+				if (index && m_states[*index] == ActionState::Init)
+					m_candidateMask[*index / 64] |= uint64_t{ 1 } << (*index % 64);
+			}
+
+			for (std::size_t w{}; w < m_candidateMask.size(); ++w)
+			{
+				for (auto word = m_candidateMask[w]; word != 0; word &= word - 1)
+				{
+					const auto index = static_cast<Index_t>(w * 64 + std::countr_zero(word));
+					if (const auto nextState = GetNextTransition(stateUpdate, index, nowCount))
+						transitions.Add({ index, *nextState });
+				}
+			}
+		}
+
+		[[nodiscard]] auto MakeTransitionPack() const -> TransitionPack
+		{
+			TransitionPack transitions;
+			transitions.Reserve(m_mappings->size());
+			return transitions;
+		}
+
+		/**
+		 * \brief	Performs the record, calling the mapping function for the transition (if any) then advancing the mapping state.
+		 */
+		void Execute(const TransitionRecord record, const TimePoint_t now = Clock_t::now())
+		{
+			Translator::CallMappingFunction((*m_mappings)[record.MappingIndex], record.Transition);
+			AdvanceState(record, now);
+		}
+
+		/**
+		 * \brief	Performs every record in the pack, key-ups then key-downs then repeats then resets.
+		 */
+		void Execute(const TransitionPack& transitions, const TimePoint_t now = Clock_t::now())
+		{
+			for (const auto record : transitions.UpRequests)
+				Execute(record, now);
+			for (const auto record : transitions.DownRequests)
+				Execute(record, now);
+			for (const auto record : transitions.RepeatRequests)
+				Execute(record, now);
+			for (const auto record : transitions.UpdateRequests)
+				Execute(record, now);
+		}
+
+		/**
+		 * \brief	Advances the mapping state for the record without calling the mapping function, storing only the deadline relevant to the new state.
+		 */
+		void AdvanceState(const TransitionRecord record, const TimePoint_t now = Clock_t::now()) noexcept
+		{
+			const auto index = record.MappingIndex;
+			const auto& mapping = (*m_mappings)[index];
+			const int64_t nowCount = now.time_since_epoch().count();
+			const bool usesRepeat = mapping.RepeatingKeyBehavior != RepeatType::None;
+
+			switch (record.Transition)
+			{
+			case ActionState::KeyDown:
+				if (m_states[index] != ActionState::Init)
+					return;
+				m_lastSentTimes[index] = nowCount;
+				m_downTimes[index] = nowCount;
+				m_firstRepeatDeadlines[index] = usesRepeat ? nowCount + m_firstRepeatDelays[index] : NoDeadline;
+				m_repeatDeadlines[index] = NoDeadline;
+				SetHeld(index, true);
+				break;
+			case ActionState::KeyRepeat:
+				if (m_states[index] != ActionState::KeyDown && m_states[index] != ActionState::KeyRepeat)
+					return;
+				if (mapping.RepeatingKeyBehavior == RepeatType::Accelerating)
+				{
+					const TimePoint_t downTime{ Nanos_t{ m_downTimes[index] } };
+					const TimePoint_t scheduled{ Nanos_t{ m_states[index] == ActionState::KeyDown ? m_firstRepeatDeadlines[index] : m_repeatDeadlines[index] } };
+					const auto start = GetAcceleratedRepeatStart(mapping, downTime, scheduled, now);
+					m_lastSentTimes[index] = start.time_since_epoch().count();
+					m_repeatDeadlines[index] = m_lastSentTimes[index] + GetAcceleratedRepeatDelay(mapping, start - downTime).count();
+				}
+				else
+				{
+					m_lastSentTimes[index] = nowCount;
+					m_repeatDeadlines[index] = mapping.RepeatingKeyBehavior == RepeatType::Infinite ? nowCount + m_repeatDelays[index] : NoDeadline;
+				}
+				m_firstRepeatDeadlines[index] = NoDeadline;
+				break;
+			case ActionState::KeyUp:
+				if (m_states[index] != ActionState::KeyDown && m_states[index] != ActionState::KeyRepeat)
+					return;
+				m_firstRepeatDeadlines[index] = NoDeadline;
+				m_repeatDeadlines[index] = m_lastSentTimes[index] + m_repeatDelays[index];
+				SetHeld(index, false);
+				break;
+			case ActionState::Init:
+				if (m_states[index] != ActionState::KeyUp)
+					return;
+				m_lastSentTimes[index] = nowCount;
+				m_firstRepeatDeadlines[index] = NoDeadline;
+				m_repeatDeadlines[index] = NoDeadline;
+				break;
+			}
+			m_states[index] = record.Transition;
+		}
+
+		/**
+		 * \brief	Key-up records for every mapping that is down or repeating.
+		 */
+		[[nodiscard]] auto GetCleanupTransitions() const -> SmallVector_t<TransitionRecord>
+		{
+			SmallVector_t<TransitionRecord> transitions;
+			for (std::size_t i{}; i < m_states.size(); ++i)
+			{
+				if (m_states[i] == ActionState::KeyDown || m_states[i] == ActionState::KeyRepeat)
+					transitions.push_back({ static_cast<Index_t>(i), ActionState::KeyUp });
+			}
+			return transitions;
+		}
+
+		/**
+		 * \brief	Gets the earliest point in time at which any mapping has a timer driven state change pending, empty optional if none.
+		 */
+		[[nodiscard]] auto GetNextDeadline() const noexcept -> std::optional<TimePoint_t>
+		{
+			const auto nextDeadline = std::min(std::ranges::min(m_firstRepeatDeadlines), std::ranges::min(m_repeatDeadlines));
+			if (nextDeadline == NoDeadline)
+				return {};
+			return TimePoint_t{ Nanos_t{ nextDeadline } };
+		}
+
+		[[nodiscard]] auto GetMappingsRange() const noexcept -> std::shared_ptr<const MappingVector_t>
+		{
+			return m_mappings;
+		}
+
+		[[nodiscard]] auto GetKeyIndex() const noexcept -> std::shared_ptr<const VirtualKeyIndex>
+		{
+			return m_keyIndex;
+		}
+	private:
+		void SetHeld(const Index_t index, const bool isHeld) noexcept
+		{
+			const auto bit = uint64_t{ 1 } << (index % 64);
+			if (isHeld)
+				m_heldMask[index / 64] |= bit;
+			else
+				m_heldMask[index / 64] &= ~bit;
+		}
+
+		// Same transition rules and priority as the free function GetNextTransition(...) for MappingStateTracker.
+		[[nodiscard]] auto GetNextTransition(const auto& stateUpdate, const Index_t index, const int64_t nowCount) const noexcept -> std::optional<ActionState>
+		{
+			const auto& mapping = (*m_mappings)[index];
+			const auto isElapsed = [nowCount](const int64_t deadline) { return deadline - nowCount < 0; };
+
+			switch (m_states[index])
+			{
+			case ActionState::KeyUp:
+				if (isElapsed(m_repeatDeadlines[index]))
+					return ActionState::Init;
+				break;
+			case ActionState::Init:
+				if (IsVirtualKeyDown(stateUpdate, mapping.ButtonVirtualKeycode))
+					return ActionState::KeyDown;
+				break;
+			case ActionState::KeyDown:
+			case ActionState::KeyRepeat:
+				if (!IsVirtualKeyDown(stateUpdate, mapping.ButtonVirtualKeycode))
+					return ActionState::KeyUp;
+				if (isElapsed(m_firstRepeatDeadlines[index]) || isElapsed(m_repeatDeadlines[index]))
+					return ActionState::KeyRepeat;
+				break;
+			}
+			return {};
+		}
+	};
+	static_assert(std::movable<SoaTranslator> == true);
+	static_assert(std::copyable<SoaTranslator> == false);
+}
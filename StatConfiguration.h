@@ -8,66 +8,73 @@
 #include <Windows.h>
 #include "StreamToActionTranslator.h"
 #include "Win32Overlay.h"
+#include "InputSink.h"
+#include "PointerMotion.h"
+#include "ScrollMotion.h"
 #include <atomic>
+#include <array>
 
 /**
 * \brief Key Repeat Delay is the time delay a button has in-between activations.
 */
 static constexpr sds::Nanos_t KeyRepeatDelay{ std::chrono::microseconds{100'000} };
 
-// Mouse Movement
-static constexpr int32_t MouseMoveUp{ 1 };
-static constexpr int32_t MouseMoveDown{ 2 };
-static constexpr int32_t MouseMoveRight{ 3 };
-static constexpr int32_t MouseMoveLeft{ 4 };
-
-static constexpr int32_t MouseMoveUpLeft{ 5 };
-static constexpr int32_t MouseMoveUpRight{ 6 };
-static constexpr int32_t MouseMoveDownRight{ 7 };
-static constexpr int32_t MouseMoveDownLeft{ 8 };
-
-// Mouse Clicks
-static constexpr int32_t MouseLeftClick{ 9 };
-static constexpr int32_t MouseRightClick{ 10 };
-static constexpr int32_t MouseMiddleClick{ 11 };
-
-// Mouse Scroll
-static constexpr int32_t MouseScrollUp{ 12 };
-static constexpr int32_t MouseScrollDown{ 13 };
-
-// Additional Mouse Functions
-static constexpr int32_t MouseDragStart{ 14 };
-static constexpr int32_t MouseDragEnd{ 15 };
-
-// On-Screen Keyboard
-static constexpr int32_t ToggleOnScreenKeyboard{ 16 };
-
-// Multimedia Controls
-static constexpr int32_t MediaPlayPause{ 17 };
-static constexpr int32_t MediaNextTrack{ 18 };
-static constexpr int32_t MediaPrevTrack{ 19 };
-static constexpr int32_t VolumeUp{ 20 };
-static constexpr int32_t VolumeDown{ 21 };
-static constexpr int32_t VolumeMute{ 22 };
-static constexpr int32_t MediaStop{ 23 };
-
-static constexpr int32_t LaunchAmazonPrime{ 24 };
-static constexpr int32_t LaunchTubi{ 25 };
-static constexpr int32_t LaunchNetflix{ 26 };
-static constexpr int32_t EscapeKey{ 27 };
-static constexpr int32_t SensitivityToggle{ 28 };
-static constexpr int32_t ToggleMonitorOverlay{ 29 };
+/**
+ * \brief	Every command keycode, and the name of the command message that sends it (empty if no command sends it).
+ *	The keycode constants below and the command name lookup are both generated from this list, add a command here and nowhere else.
+ *	X(Constant, Keycode, CommandName)
+ */
+#define ARC_COMMAND_KEYCODES(X) \
+	/* Mouse Movement */ \
+	X(MouseMoveUp, 1, "move_up") \
+	X(MouseMoveDown, 2, "move_down") \
+	X(MouseMoveRight, 3, "move_right") \
+	X(MouseMoveLeft, 4, "move_left") \
+	X(MouseMoveUpLeft, 5, "move_up_left") \
+	X(MouseMoveUpRight, 6, "move_up_right") \
+	X(MouseMoveDownRight, 7, "move_down_right") \
+	X(MouseMoveDownLeft, 8, "move_down_left") \
+	/* Mouse Clicks */ \
+	X(MouseLeftClick, 9, "click_left") \
+	X(MouseRightClick, 10, "click_right") \
+	X(MouseMiddleClick, 11, "click_middle") \
+	/* Mouse Scroll */ \
+	X(MouseScrollUp, 12, "scroll_up") \
+	X(MouseScrollDown, 13, "scroll_down") \
+	/* Additional Mouse Functions */ \
+	X(MouseDragStart, 14, "drag_start") \
+	X(MouseDragEnd, 15, "drag_end") \
+	/* On-Screen Keyboard, "osk_toggle" is not handled yet */ \
+	X(ToggleOnScreenKeyboard, 16, "") \
+	/* Multimedia Controls */ \
+	X(MediaPlayPause, 17, "play_pause") \
+	X(MediaNextTrack, 18, "next_track") \
+	X(MediaPrevTrack, 19, "previous_track") \
+	X(VolumeUp, 20, "volume_up") \
+	X(VolumeDown, 21, "volume_down") \
+	X(VolumeMute, 22, "mute_toggle") \
+	X(MediaStop, 23, "stop") \
+	/* Launchers */ \
+	X(LaunchAmazonPrime, 24, "open_prime_video") \
+	X(LaunchTubi, 25, "open_tubi") \
+	X(LaunchNetflix, 26, "open_netflix") \
+	X(EscapeKey, 27, "press_escape") \
+	X(SensitivityToggle, 28, "toggle_mouse_sensitivity") \
+	X(ToggleMonitorOverlay, 29, "toggle_blue_light_filter")
+
+#define ARC_DEFINE_KEYCODE(constant, keycode, name) static constexpr int32_t constant{ keycode };
+ARC_COMMAND_KEYCODES(ARC_DEFINE_KEYCODE)
+#undef ARC_DEFINE_KEYCODE
 
 struct SensitivityToggler
 {
-	std::atomic<int> CurrentSensitivity{ 1 };
+	// Pointer speed multipliers, Toggle() steps through them in order and wraps around.
+	static constexpr std::array Levels{ 1.0, 1.5, 2.0, 3.0, 0.5 };
+	std::atomic<std::size_t> CurrentLevel{ 0 };
 
-	int Get() { return CurrentSensitivity.load(); }
+	double Get() const { return Levels[CurrentLevel.load()]; }
 	auto Toggle() {
-		if (CurrentSensitivity.load() == 1)
-			CurrentSensitivity.store(2);
-		else
-			CurrentSensitivity.store(1);
+		CurrentLevel.store((CurrentLevel.load() + 1) % Levels.size());
 	}
 };
 
@@ -78,49 +85,45 @@ SensitivityToggler& GetSensitivityTogglerInstance()
 	return instance;
 }
 
-inline auto CallSendInput(INPUT* inp, std::uint32_t numSent) noexcept -> UINT
+// get global input sink instance, the actions write into it on the client thread, and the translator tick (or the release of the held input) flushes it.
+inline InputSink& GetInputSinkInstance()
 {
-	return SendInput(static_cast<UINT>(numSent), inp, sizeof(INPUT));
+	static Win32SendInputSink instance;
+	return instance;
 }
 
-inline void SendMouseMove(const int x, const int y) noexcept
+// get global pointer motion instance, the move mappings set its held directions and the translator tick (or the release of the held input) updates it, all on the client thread.
+inline PointerMotion& GetPointerMotionInstance()
 {
-	INPUT m_mouseMoveInput{};
-	m_mouseMoveInput.type = INPUT_MOUSE;
-	m_mouseMoveInput.mi.dwFlags = MOUSEEVENTF_MOVE;
+	static PointerMotion instance;
+	return instance;
+}
 
-	using dx_t = decltype(m_mouseMoveInput.mi.dx);
-	using dy_t = decltype(m_mouseMoveInput.mi.dy);
-	m_mouseMoveInput.mi.dx = static_cast<dx_t>(x);
-	m_mouseMoveInput.mi.dy = -static_cast<dy_t>(y);
-	m_mouseMoveInput.mi.dwExtraInfo = GetMessageExtraInfo();
-	//Finally, send the input
-	CallSendInput(&m_mouseMoveInput, 1);
+// get global scroll motion instance, the scroll mappings set its held direction and the translator tick (or the release of the held input) updates it, all on the client thread.
+inline ScrollMotion& GetScrollMotionInstance()
+{
+	static ScrollMotion instance;
+	return instance;
 }
 
 // Simulate Mouse Clicks
 inline void SendMouseClick(int button)
 {
-	INPUT input = {};
-	input.type = INPUT_MOUSE;
+	const auto sendClick = [](const InjectedMouseButton injectedButton)
+	{
+		auto& sink = GetInputSinkInstance();
+		sink.MouseButton(injectedButton, true);
+		sink.MouseButton(injectedButton, false);
+	};
 
 	if (button == MouseLeftClick) {
-		input.mi.dwFlags = MOUSEEVENTF_LEFTDOWN;
-		SendInput(1, &input, sizeof(INPUT));
-		input.mi.dwFlags = MOUSEEVENTF_LEFTUP;
-		SendInput(1, &input, sizeof(INPUT));
+		sendClick(InjectedMouseButton::Left);
 	}
 	else if (button == MouseRightClick) {
-		input.mi.dwFlags = MOUSEEVENTF_RIGHTDOWN;
-		SendInput(1, &input, sizeof(INPUT));
-		input.mi.dwFlags = MOUSEEVENTF_RIGHTUP;
-		SendInput(1, &input, sizeof(INPUT));
+		sendClick(InjectedMouseButton::Right);
 	}
 	else if (button == MouseMiddleClick) {
-		input.mi.dwFlags = MOUSEEVENTF_MIDDLEDOWN;
-		SendInput(1, &input, sizeof(INPUT));
-		input.mi.dwFlags = MOUSEEVENTF_MIDDLEUP;
-		SendInput(1, &input, sizeof(INPUT));
+		sendClick(InjectedMouseButton::Middle);
 	}
 }
 
@@ -137,275 +140,184 @@ inline void ToggleOnScreenKeyboardFn()
 	keyboardOpen = !keyboardOpen;
 }
 
-inline void SendMultimediaKey(const WORD vk, const bool doDown) noexcept
+inline void SendMultimediaKey(const WORD vk, const bool doDown)
 {
-	INPUT keyInput{};
-	keyInput.type = INPUT_KEYBOARD;
-	keyInput.ki.wVk = vk;
-	keyInput.ki.dwExtraInfo = GetMessageExtraInfo();
-	if (!doDown)
-	{
-		keyInput.ki.dwFlags = KEYEVENTF_KEYUP;
-	}
-	//Finally, send the input
-	CallSendInput(&keyInput, 1);
+	GetInputSinkInstance().Key(vk, doDown);
 }
 
-inline auto GetClickMappings()
+/**
+ * \brief	The kind of action a driver mapping performs, see PerformDriverAction(...).
+ */
+enum class DriverActionKind : uint8_t
 {
-	using std::vector, sds::MappingContainer, std::cout;
-	using namespace std::chrono_literals;
-	using namespace sds;
-
-	SmallVector_t<MappingContainer> clickMappings =
-	{
-		// Left Click
-		MappingContainer
-		{
-			.OnDown = []() { SendMouseClick(MouseLeftClick); },
-			.ButtonVirtualKeycode = MouseLeftClick,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
+	None,
+	MouseMove,
+	MouseScroll,
+	MouseClick,
+	MultimediaKey,
+	LaunchCommand,
+	ToggleSensitivity,
+	PostUiCommand
+};
 
-		// Right Click
-		MappingContainer
-		{
-			.OnDown = []() { SendMouseClick(MouseRightClick); },
-			.ButtonVirtualKeycode = MouseRightClick,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
+/**
+ * \brief	The constexpr parameters of a driver mapping's action. Mouse move X/Y is the direction held in the PointerMotion while the mapping is down,
+ *	and mouse scroll Y the direction held in the ScrollMotion.
+ */
+struct DriverAction
+{
+	DriverActionKind Kind{};
+	int32_t X{};
+	int32_t Y{};
+	// Mouse button keycode, virtual key, or UI command id, depending on the kind.
+	int32_t Code{};
+	const char* Command{};
+};
 
-		// Middle Click
-		MappingContainer
-		{
-			.OnDown = []() { SendMouseClick(MouseMiddleClick); },
-			.ButtonVirtualKeycode = MouseMiddleClick,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
+inline void PerformDriverAction(const DriverAction& action, const sds::ActionState transition, HWND uiHwnd)
+{
+	using sds::ActionState;
 
-		//// Toggle On-Screen Keyboard
-		//MappingContainer
-		//{
-		//	.OnDown = []() { ToggleOnScreenKeyboardFn(); },
-		//	.ButtonVirtualKeycode = ToggleOnScreenKeyboard,
-		//	.RepeatingKeyBehavior = RepeatType::None
-		//}
-	};
-	return clickMappings;
+	const bool isDown = transition == ActionState::KeyDown;
+	switch (action.Kind)
+	{
+	case DriverActionKind::MouseMove:
+		if (isDown || transition == ActionState::KeyUp)
+			GetPointerMotionInstance().SetDirectionHeld(action.X, action.Y, isDown);
+		break;
+	case DriverActionKind::MouseScroll:
+		if (isDown || transition == ActionState::KeyUp)
+			GetScrollMotionInstance().SetDirectionHeld(action.Y, isDown);
+		break;
+	case DriverActionKind::MouseClick:
+		if (isDown)
+			SendMouseClick(action.Code);
+		break;
+	case DriverActionKind::MultimediaKey:
+		// A repeat is another key-down, as the keyboard's own auto-repeat would send.
+		if (isDown || transition == ActionState::KeyRepeat || transition == ActionState::KeyUp)
+			SendMultimediaKey(static_cast<WORD>(action.Code), transition != ActionState::KeyUp);
+		break;
+	case DriverActionKind::LaunchCommand:
+		if (isDown)
+			system(action.Command);
+		break;
+	case DriverActionKind::ToggleSensitivity:
+		if (isDown)
+			GetSensitivityTogglerInstance().Toggle();
+		break;
+	case DriverActionKind::PostUiCommand:
+		if (isDown)
+			PostMessage(uiHwnd, WM_COMMAND, static_cast<WPARAM>(action.Code), 0);
+		break;
+	case DriverActionKind::None:
+		break;
+	}
 }
 
-inline auto GetDriverMouseMappings()
+namespace detail
 {
-	using std::vector, std::cout;
-	using namespace std::chrono_literals;
-	using namespace sds;
-
-	constexpr auto FirstDelay = std::chrono::nanoseconds(0);   // No initial delay
-	constexpr auto RepeatDelay = std::chrono::microseconds(1200);  // 1.2ms repeat delay
+	using DriverMapping_t = sds::MappingDescription<DriverAction>;
 
-	vector<MappingContainer> mapBuffer =
+	// Moves only set the held direction on down/up, the PointerMotion produces the movement, so there are no repeats.
+	constexpr auto MakeMove(const int32_t vk, const int32_t x, const int32_t y) noexcept -> DriverMapping_t
 	{
-		// Move Up
-		MappingContainer
-		{
-			.OnDown = [&]() { SendMouseMove(0, GetSensitivityTogglerInstance().Get()); },
-			.OnRepeat = [&]() { SendMouseMove(0, GetSensitivityTogglerInstance().Get()); },
-			.ButtonVirtualKeycode = MouseMoveUp,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
-
-		// Move Down
-		MappingContainer
-		{
-			.OnDown = [&]() { SendMouseMove(0, -GetSensitivityTogglerInstance().Get()); },
-			.OnRepeat = [&]() { SendMouseMove(0, -GetSensitivityTogglerInstance().Get()); },
-			.ButtonVirtualKeycode = MouseMoveDown,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
-
-		// Move Right
-		MappingContainer
+		return DriverMapping_t
 		{
-			.OnDown = [&]() { SendMouseMove(GetSensitivityTogglerInstance().Get(), 0); },
-			.OnRepeat = [&]() { SendMouseMove(GetSensitivityTogglerInstance().Get(), 0); },
-			.ButtonVirtualKeycode = MouseMoveRight,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
-
-		// Move Left
-		MappingContainer
-		{
-			.OnDown = [&]() { SendMouseMove(-GetSensitivityTogglerInstance().Get(), 0); },
-			.OnRepeat = [&]() { SendMouseMove(-GetSensitivityTogglerInstance().Get(), 0); },
-			.ButtonVirtualKeycode = MouseMoveLeft,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
-
-		// Move Up-Left
-		MappingContainer
-		{
-			.OnDown = [&]() { SendMouseMove(-GetSensitivityTogglerInstance().Get(), GetSensitivityTogglerInstance().Get()); },
-			.OnRepeat = [&]() { SendMouseMove(-GetSensitivityTogglerInstance().Get(), GetSensitivityTogglerInstance().Get()); },
-			.ButtonVirtualKeycode = MouseMoveUpLeft,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
-
-		// Move Up-Right
-		MappingContainer
-		{
-			.OnDown = [&]() { SendMouseMove(GetSensitivityTogglerInstance().Get(), GetSensitivityTogglerInstance().Get()); },
-			.OnRepeat = [&]() { SendMouseMove(GetSensitivityTogglerInstance().Get(), GetSensitivityTogglerInstance().Get()); },
-			.ButtonVirtualKeycode = MouseMoveUpRight,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
+			.Action = {.Kind = DriverActionKind::MouseMove, .X = x, .Y = y },
+			.ButtonVirtualKeycode = vk,
+			.RepeatingKeyBehavior = sds::RepeatType::None
+		};
+	}
 
-		// Move Down-Right
-		MappingContainer
+	constexpr auto MakeSingle(const int32_t vk, const DriverAction action) noexcept -> DriverMapping_t
+	{
+		return DriverMapping_t
 		{
-			.OnDown = [&]() { SendMouseMove(GetSensitivityTogglerInstance().Get(), -GetSensitivityTogglerInstance().Get()); },
-			.OnRepeat = [&]() { SendMouseMove(GetSensitivityTogglerInstance().Get(), -GetSensitivityTogglerInstance().Get()); },
-			.ButtonVirtualKeycode = MouseMoveDownRight,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		},
+			.Action = action,
+			.ButtonVirtualKeycode = vk,
+			.RepeatingKeyBehavior = sds::RepeatType::None
+		};
+	}
 
-		// Move Down-Left
-		MappingContainer
+	// Holding repeats the key, slowly at first and then faster, so a small step and a large change are both quick to make.
+	constexpr auto MakeAccelerating(const int32_t vk, const DriverAction action) noexcept -> DriverMapping_t
+	{
+		using namespace std::chrono_literals;
+		return DriverMapping_t
 		{
-			.OnDown = [&]() { SendMouseMove(-GetSensitivityTogglerInstance().Get(), -GetSensitivityTogglerInstance().Get()); },
-			.OnRepeat = [&]() { SendMouseMove(-GetSensitivityTogglerInstance().Get(), -GetSensitivityTogglerInstance().Get()); },
-			.ButtonVirtualKeycode = MouseMoveDownLeft,
-			.RepeatingKeyBehavior = RepeatType::Infinite,
-			.DelayBeforeFirstRepeat = FirstDelay,
-			.BetweenRepeatDelay = RepeatDelay
-		}
-	};
-
-	return mapBuffer;
+			.Action = action,
+			.ButtonVirtualKeycode = vk,
+			.RepeatingKeyBehavior = sds::RepeatType::Accelerating,
+			.DelayBeforeFirstRepeat = 400ms,
+			.BetweenRepeatDelay = 150ms,
+			.MinimumRepeatDelay = 30ms,
+			.RepeatRampDuration = 2s
+		};
+	}
 }
 
-inline auto GetDriverKeyboardMappings(HWND uiHwnd)
+/**
+ * \brief	Every driver mapping, as a constexpr table. The index of an entry is the index of its mapping in the translator made from GetAllMappings(...).
+ */
+static constexpr std::array DriverMappingTable
 {
-	using std::vector;
-	using sds::MappingContainer;
-	using sds::RepeatType;
-
-	vector<MappingContainer> mapBuffer =
-	{
-		// Multimedia Controls
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_MEDIA_PLAY_PAUSE, true); },
-			.OnUp = []() { SendMultimediaKey(VK_MEDIA_PLAY_PAUSE, false); },
-			.ButtonVirtualKeycode = MediaPlayPause,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_MEDIA_NEXT_TRACK, true); },
-			.OnUp = []() { SendMultimediaKey(VK_MEDIA_NEXT_TRACK, false); },
-			.ButtonVirtualKeycode = MediaNextTrack,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_MEDIA_PREV_TRACK, true); },
-			.OnUp = []() { SendMultimediaKey(VK_MEDIA_PREV_TRACK, false); },
-			.ButtonVirtualKeycode = MediaPrevTrack,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_VOLUME_UP, true); },
-			.OnUp = []() { SendMultimediaKey(VK_VOLUME_UP, false); },
-			.ButtonVirtualKeycode = VolumeUp,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_VOLUME_DOWN, true); },
-			.OnUp = []() { SendMultimediaKey(VK_VOLUME_DOWN, false); },
-			.ButtonVirtualKeycode = VolumeDown,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_VOLUME_MUTE, true); },
-			.OnUp = []() { SendMultimediaKey(VK_VOLUME_MUTE, false); },
-			.ButtonVirtualKeycode = VolumeMute,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_MEDIA_STOP, true); },
-			.OnUp = []() { SendMultimediaKey(VK_MEDIA_STOP, false); },
-			.ButtonVirtualKeycode = MediaStop,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		// Launch Prime Video
-		MappingContainer{
-			.OnDown = []() { system("start https://www.amazon.com/gp/video/storefront"); },
-			.ButtonVirtualKeycode = LaunchAmazonPrime,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-
-		// Launch Tubi
-		MappingContainer{
-			.OnDown = []() { system("start https://tubitv.com"); },
-			.ButtonVirtualKeycode = LaunchTubi,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
+	// Mouse Movement
+	detail::MakeMove(MouseMoveUp, 0, 1),
+	detail::MakeMove(MouseMoveDown, 0, -1),
+	detail::MakeMove(MouseMoveRight, 1, 0),
+	detail::MakeMove(MouseMoveLeft, -1, 0),
+	detail::MakeMove(MouseMoveUpLeft, -1, 1),
+	detail::MakeMove(MouseMoveUpRight, 1, 1),
+	detail::MakeMove(MouseMoveDownRight, 1, -1),
+	detail::MakeMove(MouseMoveDownLeft, -1, -1),
+
+	// Mouse Scroll, held scrolls smoothly and coasts to a stop after release.
+	detail::MakeSingle(MouseScrollUp, {.Kind = DriverActionKind::MouseScroll, .Y = 1 }),
+	detail::MakeSingle(MouseScrollDown, {.Kind = DriverActionKind::MouseScroll, .Y = -1 }),
+
+	// Mouse Clicks
+	detail::MakeSingle(MouseLeftClick, {.Kind = DriverActionKind::MouseClick, .Code = MouseLeftClick }),
+	detail::MakeSingle(MouseRightClick, {.Kind = DriverActionKind::MouseClick, .Code = MouseRightClick }),
+	detail::MakeSingle(MouseMiddleClick, {.Kind = DriverActionKind::MouseClick, .Code = MouseMiddleClick }),
+
+	// Multimedia Controls
+	detail::MakeSingle(MediaPlayPause, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_MEDIA_PLAY_PAUSE }),
+	detail::MakeSingle(MediaNextTrack, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_MEDIA_NEXT_TRACK }),
+	detail::MakeSingle(MediaPrevTrack, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_MEDIA_PREV_TRACK }),
+	detail::MakeAccelerating(VolumeUp, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_VOLUME_UP }),
+	detail::MakeAccelerating(VolumeDown, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_VOLUME_DOWN }),
+	detail::MakeSingle(VolumeMute, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_VOLUME_MUTE }),
+	detail::MakeSingle(MediaStop, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_MEDIA_STOP }),
+
+	// Launchers
+	detail::MakeSingle(LaunchAmazonPrime, {.Kind = DriverActionKind::LaunchCommand, .Command = "start https://www.amazon.com/gp/video/storefront" }),
+	detail::MakeSingle(LaunchTubi, {.Kind = DriverActionKind::LaunchCommand, .Command = "start https://tubitv.com" }),
+	detail::MakeSingle(LaunchNetflix, {.Kind = DriverActionKind::LaunchCommand, .Command = "start https://www.netflix.com" }),
+
+	detail::MakeSingle(EscapeKey, {.Kind = DriverActionKind::MultimediaKey, .Code = VK_ESCAPE }),
+	detail::MakeSingle(SensitivityToggle, {.Kind = DriverActionKind::ToggleSensitivity }),
+	detail::MakeSingle(ToggleMonitorOverlay, {.Kind = DriverActionKind::PostUiCommand, .Code = 1002 })
+};
+static_assert(sds::AreDescriptionsValid(DriverMappingTable), "More than 1 mapping per VK, or a zero VK, in the driver mapping table!");
 
-		// Launch Netflix
-		MappingContainer{
-			.OnDown = []() { system("start https://www.netflix.com"); },
-			.ButtonVirtualKeycode = LaunchNetflix,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = []() { SendMultimediaKey(VK_ESCAPE, true); },
-			.OnUp = []() { SendMultimediaKey(VK_ESCAPE, false); },
-			.ButtonVirtualKeycode = EscapeKey,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
-		{
-			.OnDown = [&]() { GetSensitivityTogglerInstance().Toggle(); },
-			.ButtonVirtualKeycode = SensitivityToggle,
-			.RepeatingKeyBehavior = RepeatType::None
-		},
-		MappingContainer
+/**
+ * \brief	The runtime mappings for the driver mapping table, each mapping's callbacks perform its table entry's action.
+ */
+inline auto GetAllMappings(HWND uiHwnd)
+{
+	return sds::ToMappingContainers(DriverMappingTable, [uiHwnd](const DriverAction& action, const sds::ActionState transition)
 		{
-			.OnDown = [uiHwnd]() { PostMessage(uiHwnd, WM_COMMAND, 1002, 0); },
-			.ButtonVirtualKeycode = ToggleMonitorOverlay,
-			.RepeatingKeyBehavior = RepeatType::None
-		}
-	};
-
-	return mapBuffer;
+			PerformDriverAction(action, transition, uiHwnd);
+		});
 }
 
-inline auto GetAllMappings(HWND uiHwnd)
+/**
+ * \brief	Performs a translator transition with a switch on the driver mapping table, rather than through the mapping's std::function callbacks.
+ *	For use as the dispatch of <c>Translator::Execute(pack, dispatch)</c> and <c>Translator::ProcessEdgeEvents(edges, dispatch)</c>.
+ * \remarks	The translator must have been made from GetAllMappings(...).
+ */
+inline void DispatchDriverTransition(const sds::TransitionRecord record, HWND uiHwnd)
 {
-	auto clickMappings = GetClickMappings();
-	auto keyboardMappings = GetDriverKeyboardMappings(uiHwnd);
-	auto allMappings = GetDriverMouseMappings();
-	allMappings.insert(allMappings.end(), clickMappings.begin(), clickMappings.end());
-	allMappings.insert(allMappings.end(), keyboardMappings.begin(), keyboardMappings.end());
-
-	return allMappings;
-}
\ No newline at end of file
+	PerformDriverAction(DriverMappingTable[record.MappingIndex].Action, record.Transition, uiHwnd);
+}
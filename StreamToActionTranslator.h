@@ -29,6 +29,11 @@ For more information, please refer to https://unlicense.org
 #include <unordered_set>
 #include <memory>
 #include <cassert>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <cmath>
 
 namespace sds
 {
@@ -53,7 +58,9 @@ namespace sds
 		// Upon the button being held down, will send a single repeat, will not continue translating to repeat after the single repeat.
 		FirstOnly,
 		// No key-repeats sent.
-		None
+		None,
+		// As Infinite, but the delay in between repeats ramps geometrically from BetweenRepeatDelay to MinimumRepeatDelay over RepeatRampDuration of holding.
+		Accelerating
 	};
 
 	enum class ActionState
@@ -67,6 +74,7 @@ namespace sds
 	struct MappingContainer;
 	struct TranslationPack;
 	class Translator;
+	class VirtualKeyIndex;
 
 	// Concept for range of ButtonDescription type that must be contiguous.
 	template<typename T>
@@ -82,6 +90,7 @@ namespace sds
 	{
 		{ t.GetUpdatedState({ 1, 2, 3 }) } -> std::convertible_to<TranslationPack>;
 		{ t.GetMappingsRange() } -> std::convertible_to<std::shared_ptr<const SmallVector_t<MappingContainer>>>;
+		{ t.GetKeyIndex() } -> std::convertible_to<std::shared_ptr<const VirtualKeyIndex>>;
 	};
 
 	template<typename Int_t>
@@ -103,8 +112,215 @@ namespace sds
 		{ t.UpdateForNewMatchingGroupingUp(1) } -> std::convertible_to<std::optional<int32_t>>;
 	};
 
+	/**
+	 * \brief	Fixed-width set of virtual keycodes stored as a bitmask, usable in place of a SmallVector_t of down keys.
+	 *	Membership is a single indexed load, and comparing two key-states is a word-wise xor/popcount.
+	 * \remarks	Keycodes outside of [0, Width_v) are never members, attempting to add one is a no-op.
+	 *	A summary mask of non-empty words is maintained so that iteration and set operations skip empty blocks,
+	 *	which keeps very wide sets (e.g. 65536) cheap when only a few keys are down.
+	 */
+	template<std::size_t Width_v>
+	class KeySet
+	{
+		static_assert(Width_v > 0 && Width_v % 64 == 0, "KeySet width must be a non-zero multiple of 64.");
+		using Word_t = uint64_t;
+		static constexpr std::size_t WordBits{ 64 };
+		static constexpr std::size_t WordCount{ Width_v / WordBits };
+		static constexpr std::size_t SummaryCount{ (WordCount + WordBits - 1) / WordBits };
+
+		std::array<Word_t, WordCount> m_words{};
+		// Bit N is set if m_words[N] is non-zero.
+		std::array<Word_t, SummaryCount> m_summary{};
+	public:
+		using value_type = int32_t;
+
+		/**
+		 * \brief	Forward iterator over the keycodes in the set, in ascending order.
+		 */
+		class Iterator
+		{
+			const KeySet* m_set{};
+			std::size_t m_wordIndex{ WordCount };
+			Word_t m_remaining{};
+		public:
+			using value_type = int32_t;
+			using difference_type = std::ptrdiff_t;
+
+			Iterator() = default;
+			constexpr Iterator(const KeySet* theSet, const std::size_t wordIndex) noexcept
+				: m_set(theSet), m_wordIndex(wordIndex), m_remaining(wordIndex < WordCount ? theSet->m_words[wordIndex] : 0) { }
+
+			[[nodiscard]] constexpr auto operator*() const noexcept -> value_type
+			{
+				return static_cast<value_type>(m_wordIndex * WordBits + std::countr_zero(m_remaining));
+			}
+			constexpr auto operator++() noexcept -> Iterator&
+			{
+				m_remaining &= m_remaining - 1;
+				if (m_remaining == 0)
+				{
+					m_wordIndex = m_set->GetNextNonEmptyWord(m_wordIndex + 1);
+					m_remaining = m_wordIndex < WordCount ? m_set->m_words[m_wordIndex] : 0;
+				}
+				return *this;
+			}
+			constexpr auto operator++(int) noexcept -> Iterator
+			{
+				auto temp = *this;
+				++*this;
+				return temp;
+			}
+			[[nodiscard]] constexpr bool operator==(const Iterator& other) const noexcept
+			{
+				return m_wordIndex == other.m_wordIndex && m_remaining == other.m_remaining;
+			}
+			[[nodiscard]] constexpr bool operator==(std::default_sentinel_t) const noexcept
+			{
+				return m_wordIndex >= WordCount;
+			}
+		};
+	public:
+		KeySet() = default;
+		constexpr KeySet(std::initializer_list<value_type> keys) noexcept
+		{
+			for (const auto vk : keys)
+				Set(vk);
+		}
+
+		[[nodiscard]] static constexpr auto Width() noexcept -> std::size_t { return Width_v; }
+
+		[[nodiscard]] static constexpr bool IsInRange(const NotBoolIntegral_c auto vk) noexcept
+		{
+			return vk >= 0 && static_cast<std::size_t>(vk) < Width_v;
+		}
+
+		[[nodiscard]] constexpr bool Contains(const NotBoolIntegral_c auto vk) const noexcept
+		{
+			if (!IsInRange(vk))
+				return false;
+			return (m_words[static_cast<std::size_t>(vk) / WordBits] >> (static_cast<std::size_t>(vk) % WordBits)) & 1u;
+		}
+
+		/**
+		 * \brief	Adds the keycode to the set.
+		 * \return	true if the set was changed.
+		 */
+		constexpr bool Set(const NotBoolIntegral_c auto vk) noexcept
+		{
+			if (!IsInRange(vk) || Contains(vk))
+				return false;
+			const auto wordIndex = static_cast<std::size_t>(vk) / WordBits;
+			m_words[wordIndex] |= Word_t{ 1 } << (static_cast<std::size_t>(vk) % WordBits);
+			m_summary[wordIndex / WordBits] |= Word_t{ 1 } << (wordIndex % WordBits);
+			return true;
+		}
+
+		/**
+		 * \brief	Removes the keycode from the set.
+		 * \return	true if the set was changed.
+		 */
+		constexpr bool Reset(const NotBoolIntegral_c auto vk) noexcept
+		{
+			if (!Contains(vk))
+				return false;
+			const auto wordIndex = static_cast<std::size_t>(vk) / WordBits;
+			m_words[wordIndex] &= ~(Word_t{ 1 } << (static_cast<std::size_t>(vk) % WordBits));
+			if (m_words[wordIndex] == 0)
+				m_summary[wordIndex / WordBits] &= ~(Word_t{ 1 } << (wordIndex % WordBits));
+			return true;
+		}
+
+		constexpr void Clear() noexcept
+		{
+			*this = {};
+		}
+
+		[[nodiscard]] constexpr bool IsEmpty() const noexcept
+		{
+			return std::ranges::all_of(m_summary, [](const Word_t w) { return w == 0; });
+		}
+
+		[[nodiscard]] constexpr auto Count() const noexcept -> std::size_t
+		{
+			std::size_t total{};
+			ForEachNonEmptyWord(m_summary, [&](const std::size_t wordIndex) { total += std::popcount(m_words[wordIndex]); });
+			return total;
+		}
+
+		// Keys present in exactly one of the two sets, i.e. the keys that changed state.
+		[[nodiscard]] constexpr auto operator^(const KeySet& other) const noexcept -> KeySet
+		{
+			return Combine(other, [](const Word_t a, const Word_t b) { return a ^ b; });
+		}
+		[[nodiscard]] constexpr auto operator&(const KeySet& other) const noexcept -> KeySet
+		{
+			return Combine(other, [](const Word_t a, const Word_t b) { return a & b; });
+		}
+		[[nodiscard]] constexpr auto operator|(const KeySet& other) const noexcept -> KeySet
+		{
+			return Combine(other, [](const Word_t a, const Word_t b) { return a | b; });
+		}
+		// Keys in this set that are not in the other.
+		[[nodiscard]] constexpr auto Without(const KeySet& other) const noexcept -> KeySet
+		{
+			return Combine(other, [](const Word_t a, const Word_t b) { return a & ~b; });
+		}
+		[[nodiscard]] constexpr bool operator==(const KeySet& other) const noexcept = default;
+
+		[[nodiscard]] constexpr auto begin() const noexcept -> Iterator
+		{
+			return { this, GetNextNonEmptyWord(0) };
+		}
+		[[nodiscard]] constexpr auto end() const noexcept -> std::default_sentinel_t
+		{
+			return {};
+		}
+	private:
+		[[nodiscard]] constexpr auto GetNextNonEmptyWord(const std::size_t startWord) const noexcept -> std::size_t
+		{
+			for (auto summaryIndex = startWord / WordBits; summaryIndex < SummaryCount; ++summaryIndex)
+			{
+				auto summaryWord = m_summary[summaryIndex];
+				if (summaryIndex == startWord / WordBits)
+					summaryWord &= ~Word_t{} << (startWord % WordBits);
+				if (summaryWord != 0)
+					return summaryIndex * WordBits + std::countr_zero(summaryWord);
+			}
+			return WordCount;
+		}
+
+		static constexpr void ForEachNonEmptyWord(const std::array<Word_t, SummaryCount>& summary, auto&& fn) noexcept
+		{
+			for (std::size_t summaryIndex{}; summaryIndex < SummaryCount; ++summaryIndex)
+			{
+				for (auto summaryWord = summary[summaryIndex]; summaryWord != 0; summaryWord &= summaryWord - 1)
+					fn(summaryIndex * WordBits + std::countr_zero(summaryWord));
+			}
+		}
+
+		[[nodiscard]] constexpr auto Combine(const KeySet& other, auto&& wordOp) const noexcept -> KeySet
+		{
+			KeySet result;
+			std::array<Word_t, SummaryCount> candidates{};
+			for (std::size_t i{}; i < SummaryCount; ++i)
+				candidates[i] = m_summary[i] | other.m_summary[i];
+
+			ForEachNonEmptyWord(candidates, [&](const std::size_t wordIndex)
+				{
+					result.m_words[wordIndex] = wordOp(m_words[wordIndex], other.m_words[wordIndex]);
+					if (result.m_words[wordIndex] != 0)
+						result.m_summary[wordIndex / WordBits] |= Word_t{ 1 } << (wordIndex % WordBits);
+				});
+			return result;
+		}
+	};
+	static_assert(std::ranges::forward_range<KeySet<64>>);
+	static_assert(std::is_trivially_copyable_v<KeySet<256>>);
+
 	/**
 	* \brief	DelayTimer manages a non-blocking time delay, it provides functions such as IsElapsed() and Reset(...)
+	* \remarks	Each function that reads the time has an overload taking the current time as a parameter, so that a caller can make a single
+	*	clock read for many timers, or drive the timer from a ManualClock.
 	*/
 	class DelayTimer
 	{
@@ -127,11 +343,16 @@ namespace sds
 		[[nodiscard]]
 		bool IsElapsed() const noexcept
 		{
-			if (Clock_t::now() > (m_start_time + m_delayTime))
-			{
-				return true;
-			}
-			return false;
+			return IsElapsed(Clock_t::now());
+		}
+		/**
+		 * \brief	Check for elapsed, as of the given time.
+		 * \param now	The current time, typically a single snapshot shared by every timer checked during one update.
+		 */
+		[[nodiscard]]
+		bool IsElapsed(const TimePoint_t now) const noexcept
+		{
+			return now > (m_start_time + m_delayTime);
 		}
 		/**
 		 * \brief	Reset timer with chrono duration type.
@@ -139,7 +360,14 @@ namespace sds
 		 */
 		void Reset(const Nanos_t delay) noexcept
 		{
-			m_start_time = Clock_t::now();
+			Reset(Clock_t::now(), delay);
+		}
+		/**
+		 * \brief	Reset timer with chrono duration type, starting at the given time.
+		 */
+		void Reset(const TimePoint_t now, const Nanos_t delay) noexcept
+		{
+			m_start_time = now;
 			m_delayTime = { delay };
 		}
 		/**
@@ -147,7 +375,14 @@ namespace sds
 		 */
 		void Reset() noexcept
 		{
-			m_start_time = Clock_t::now();
+			Reset(Clock_t::now());
+		}
+		/**
+		 * \brief	Reset timer to last used duration value, starting at the given time.
+		 */
+		void Reset(const TimePoint_t now) noexcept
+		{
+			m_start_time = now;
 		}
 		/**
 		 * \brief	Gets the current timer period/duration for elapsing.
@@ -156,6 +391,47 @@ namespace sds
 		{
 			return m_delayTime;
 		}
+		/**
+		 * \brief	Gets the point in time the timer was last started at.
+		 */
+		[[nodiscard]]
+		auto GetStartTime() const noexcept -> TimePoint_t
+		{
+			return m_start_time;
+		}
+		/**
+		 * \brief	Gets the point in time after which the timer is considered elapsed.
+		 */
+		[[nodiscard]]
+		auto GetDeadline() const noexcept -> TimePoint_t
+		{
+			return m_start_time + m_delayTime;
+		}
+	};
+
+	/**
+	 * \brief	A manually advanced clock, for deterministic tests and replay. Its time points are Clock_t time points,
+	 *	so <c>Now()</c> can be passed anywhere the translator takes the current time, and hours of repeats can be simulated without waiting.
+	 */
+	class ManualClock
+	{
+		TimePoint_t m_now{};
+	public:
+		ManualClock() = default;
+		explicit ManualClock(const TimePoint_t start) noexcept : m_now(start) { }
+
+		[[nodiscard]] auto Now() const noexcept -> TimePoint_t
+		{
+			return m_now;
+		}
+		void Advance(const Nanos_t duration) noexcept
+		{
+			m_now += duration;
+		}
+		void Set(const TimePoint_t now) noexcept
+		{
+			m_now = now;
+		}
 	};
 
 	/**
@@ -163,6 +439,7 @@ namespace sds
 	 *		and that there exists only one 'current' state, and that it can only be a finite set of possibilities.
 	 *		Also contains last sent time (for key-repeat), and delay before first key-repeat timer.
 	 * \remarks	This class enforces an invariant that it's state cannot be altered out of sequence.
+	 *	The timers are read and reset with the time of the update that caused the transition (see DelayTimer), not the time the transition is performed.
 	 */
 	class 
 		//alignas(std::hardware_constructive_interference_size) 
@@ -244,10 +521,75 @@ namespace sds
 		std::optional<GrpVal_t> ExclusivityGrouping; // TODO one variation of ex. group behavior is to have a priority value associated with the mapping.
 		std::optional<Nanos_t> DelayBeforeFirstRepeat;
 		std::optional<Nanos_t> BetweenRepeatDelay;
+		// RepeatType::Accelerating only, the delay in between repeats once fully ramped, defaults to BetweenRepeatDelay (no ramp).
+		std::optional<Nanos_t> MinimumRepeatDelay;
+		// RepeatType::Accelerating only, the hold duration over which the delay ramps, an empty or zero value uses MinimumRepeatDelay from the first repeat.
+		std::optional<Nanos_t> RepeatRampDuration;
 	};
 	static_assert(std::copyable<MappingContainer>);
 	static_assert(std::movable<MappingContainer>);
 
+	/**
+	 * \brief	A declarative, constexpr counterpart of MappingContainer, the four callbacks are replaced by a plain action value.
+	 * \remarks	A constexpr array of these is a dense table, the mapping made from an entry by <c>ToMappingContainers(...)</c> has the same index,
+	 *	so a TransitionRecord's MappingIndex selects the entry and the action can be performed by a switch with no std::function involved.
+	 */
+	template<typename Action_t>
+	struct MappingDescription
+	{
+		Action_t Action{};
+		int32_t ButtonVirtualKeycode{};
+		RepeatType RepeatingKeyBehavior{};
+		std::optional<GrpVal_t> ExclusivityGrouping;
+		std::optional<Nanos_t> DelayBeforeFirstRepeat;
+		std::optional<Nanos_t> BetweenRepeatDelay;
+		std::optional<Nanos_t> MinimumRepeatDelay;
+		std::optional<Nanos_t> RepeatRampDuration;
+	};
+
+	// Performs the action of a MappingDescription for a transition, typically a switch on the kind of action.
+	template<typename Performer_t, typename Action_t>
+	concept ActionPerformer_c = std::invocable<const Performer_t&, const Action_t&, ActionState>;
+
+	/**
+	 * \brief	Makes the runtime mapping for a description, each callback calls the performer with the action and the transition.
+	 */
+	template<typename Action_t, ActionPerformer_c<Action_t> Performer_t>
+	[[nodiscard]] auto ToMappingContainer(const MappingDescription<Action_t>& description, const Performer_t& performer) -> MappingContainer
+	{
+		const auto makeFn = [&](const ActionState transition) -> Fn_t
+		{
+			return [performer, action = description.Action, transition]() { performer(action, transition); };
+		};
+		return MappingContainer
+		{
+			.OnDown = makeFn(ActionState::KeyDown),
+			.OnUp = makeFn(ActionState::KeyUp),
+			.OnRepeat = makeFn(ActionState::KeyRepeat),
+			.OnReset = makeFn(ActionState::Init),
+			.ButtonVirtualKeycode = description.ButtonVirtualKeycode,
+			.RepeatingKeyBehavior = description.RepeatingKeyBehavior,
+			.ExclusivityGrouping = description.ExclusivityGrouping,
+			.DelayBeforeFirstRepeat = description.DelayBeforeFirstRepeat,
+			.BetweenRepeatDelay = description.BetweenRepeatDelay,
+			.MinimumRepeatDelay = description.MinimumRepeatDelay,
+			.RepeatRampDuration = description.RepeatRampDuration
+		};
+	}
+
+	/**
+	 * \brief	Makes the runtime mapping vector for a table of descriptions, in table order, for use with the Translator.
+	 */
+	template<typename Action_t, std::size_t Size_v, ActionPerformer_c<Action_t> Performer_t>
+	[[nodiscard]] auto ToMappingContainers(const std::array<MappingDescription<Action_t>, Size_v>& table, const Performer_t& performer) -> SmallVector_t<MappingContainer>
+	{
+		SmallVector_t<MappingContainer> mappings;
+		mappings.reserve(table.size());
+		for (const auto& description : table)
+			mappings.push_back(ToMappingContainer(description, performer));
+		return mappings;
+	}
+
 	/**
 	 * \brief	TranslationResult holds info from a translated state change, typically the operation to perform (if any) and
 	 *		a function to call to advance the state to the next state to continue to receive proper translation results.
@@ -301,6 +643,28 @@ namespace sds
 				elem();
 		}
 
+		/**
+		 * \brief	Removes all requests but keeps the allocated capacity, so a pack can be re-used for the next update without allocating.
+		 */
+		void Clear() noexcept
+		{
+			UpRequests.clear();
+			DownRequests.clear();
+			RepeatRequests.clear();
+			UpdateRequests.clear();
+		}
+
+		/**
+		 * \brief	Reserves each request range for the given number of mappings, a mapping produces at most one request per update.
+		 */
+		void Reserve(const std::size_t mappingCount)
+		{
+			UpRequests.reserve(mappingCount);
+			DownRequests.reserve(mappingCount);
+			RepeatRequests.reserve(mappingCount);
+			UpdateRequests.reserve(mappingCount);
+		}
+
 		SmallVector_t<TranslationResult> UpRequests{}; // key-ups
 		SmallVector_t<TranslationResult> DownRequests{}; // key-downs
 		SmallVector_t<TranslationResult> RepeatRequests{}; // repeats
@@ -311,10 +675,153 @@ namespace sds
 	static_assert(std::copyable<TranslationPack>);
 	static_assert(std::movable<TranslationPack>);
 
+	/**
+	 * \brief	TransitionRecord is the closure-free form of a TranslationResult: the index of the mapping, and the state it is transitioning to.
+	 * \remarks	Records are executed by the Translator that produced them, via <c>Translator::Execute(...)</c>, which calls the matching
+	 *	MappingContainer function and advances the mapping state in place. Being trivially copyable, records are cheap to cache, log, and move between threads.
+	 */
+	struct TransitionRecord
+	{
+		// Index of the mapping in the translator's mapping range
+		Index_t MappingIndex{};
+		// State being transitioned to, KeyDown/KeyRepeat/KeyUp call OnDown/OnRepeat/OnUp, Init calls OnReset.
+		ActionState Transition{};
+	};
+	static_assert(std::is_trivially_copyable_v<TransitionRecord>);
+
+	/**
+	 * \brief	A single timestamped key-down or key-up edge, the alternative to a level snapshot of the down keys.
+	 * \remarks	A down and up edge for the same key arriving between two updates are both observed, where a snapshot would see neither.
+	 *	See <c>Translator::ProcessEdgeEvents(...)</c>.
+	 */
+	struct KeyEdgeEvent
+	{
+		int32_t VirtualKeycode{};
+		bool IsDown{};
+		// Time the edge was received, the mapping timers for the resulting transitions start from this.
+		TimePoint_t Time{};
+	};
+	static_assert(std::is_trivially_copyable_v<KeyEdgeEvent>);
+
+	/**
+	 * \brief	TransitionPack is the TransitionRecord counterpart of TranslationPack, with the same request ranges and priority order.
+	 */
+	struct TransitionPack
+	{
+		void Clear() noexcept
+		{
+			UpRequests.clear();
+			DownRequests.clear();
+			RepeatRequests.clear();
+			UpdateRequests.clear();
+		}
+
+		void Reserve(const std::size_t mappingCount)
+		{
+			UpRequests.reserve(mappingCount);
+			DownRequests.reserve(mappingCount);
+			RepeatRequests.reserve(mappingCount);
+			UpdateRequests.reserve(mappingCount);
+		}
+
+		// Adds the record to the request range for its transition.
+		void Add(const TransitionRecord record)
+		{
+			switch (record.Transition)
+			{
+			case ActionState::KeyUp:
+				UpRequests.push_back(record);
+				break;
+			case ActionState::KeyDown:
+				DownRequests.push_back(record);
+				break;
+			case ActionState::KeyRepeat:
+				RepeatRequests.push_back(record);
+				break;
+			case ActionState::Init:
+				UpdateRequests.push_back(record);
+				break;
+			}
+		}
+
+		[[nodiscard]] bool IsEmpty() const noexcept
+		{
+			return UpRequests.empty() && DownRequests.empty() && RepeatRequests.empty() && UpdateRequests.empty();
+		}
+
+		SmallVector_t<TransitionRecord> UpRequests{}; // key-ups
+		SmallVector_t<TransitionRecord> DownRequests{}; // key-downs
+		SmallVector_t<TransitionRecord> RepeatRequests{}; // repeats
+		SmallVector_t<TransitionRecord> UpdateRequests{}; // resets
+	};
+	static_assert(std::copyable<TransitionPack>);
+	static_assert(std::movable<TransitionPack>);
+
+#pragma region Repeat_Schedule
+
+	/**
+	 * \brief	The delay in between repeats of a RepeatType::Accelerating mapping, after the mapping has been held down for 'heldFor'.
+	 * \remarks	Geometric, the delay is multiplied by the same factor for each equal slice of the ramp, so the repeat rate speeds up evenly as perceived.
+	 */
+	[[nodiscard]] inline auto GetAcceleratedRepeatDelay(const MappingContainer& mapping, const Nanos_t heldFor) noexcept -> Nanos_t
+	{
+		const auto initialDelay = mapping.BetweenRepeatDelay.value_or(DelayTimer::DefaultKeyRepeatDelay);
+		const auto minimumDelay = mapping.MinimumRepeatDelay.value_or(initialDelay);
+		const auto rampDuration = mapping.RepeatRampDuration.value_or(Nanos_t{});
+		if (heldFor >= rampDuration || initialDelay.count() <= 0)
+			return minimumDelay;
+		if (heldFor <= Nanos_t{})
+			return initialDelay;
+
+		const double fraction = static_cast<double>(heldFor.count()) / static_cast<double>(rampDuration.count());
+		const double ratio = static_cast<double>(minimumDelay.count()) / static_cast<double>(initialDelay.count());
+		return Nanos_t{ static_cast<Nanos_t::rep>(static_cast<double>(initialDelay.count()) * std::pow(ratio, fraction)) };
+	}
+
+	/**
+	 * \brief	The start of the delay before the next repeat of a RepeatType::Accelerating mapping.
+	 * \param downTime	Time of the key-down.
+	 * \param scheduled	Time the repeat being sent was due.
+	 * \remarks	When the repeat is late by less than a delay, the next one is scheduled from when this one was due, so update jitter does not
+	 *	accumulate into the schedule. Later than that (e.g. the updates stalled) it restarts from now, rather than sending a burst of repeats.
+	 */
+	[[nodiscard]] inline auto GetAcceleratedRepeatStart(const MappingContainer& mapping, const TimePoint_t downTime, const TimePoint_t scheduled, const TimePoint_t now) noexcept -> TimePoint_t
+	{
+		return now - scheduled < GetAcceleratedRepeatDelay(mapping, scheduled - downTime) ? scheduled : now;
+	}
+
+	/**
+	 * \brief	Resets the repeat timer of a mapping sending a repeat, call prior to setting the tracker to the repeat state.
+	 */
+	inline void ResetRepeatTimer(const MappingContainer& mapping, MappingStateTracker& stateTracker, const TimePoint_t now) noexcept
+	{
+		if (mapping.RepeatingKeyBehavior != RepeatType::Accelerating)
+		{
+			stateTracker.LastSentTime.Reset(now);
+			return;
+		}
+		// The first repeat timer is started by the key-down, and is not reset again until the next one.
+		const auto downTime = stateTracker.DelayBeforeFirstRepeat.GetStartTime();
+		const auto scheduled = stateTracker.IsRepeating() ? stateTracker.LastSentTime.GetDeadline() : stateTracker.DelayBeforeFirstRepeat.GetDeadline();
+		const auto start = GetAcceleratedRepeatStart(mapping, downTime, scheduled, now);
+		stateTracker.LastSentTime.Reset(start, GetAcceleratedRepeatDelay(mapping, start - downTime));
+	}
+
+	/**
+	 * \brief	Restores the repeat timer period of a RepeatType::Accelerating mapping on key-up, the reset delay after key-up uses the un-ramped delay.
+	 */
+	inline void RestoreRepeatDelay(const MappingContainer& mapping, MappingStateTracker& stateTracker) noexcept
+	{
+		if (mapping.RepeatingKeyBehavior == RepeatType::Accelerating)
+			stateTracker.LastSentTime.Reset(stateTracker.LastSentTime.GetStartTime(), mapping.BetweenRepeatDelay.value_or(DelayTimer::DefaultKeyRepeatDelay));
+	}
+
+#pragma endregion Repeat_Schedule
+
 #pragma region Factory_Functions_For_Translator
 
 	// These are a few 'factory' functions, to create the appropriate TranslationResult for the next mapping state--they are tremendously useful.
-	[[nodiscard]] inline auto GetResetTranslationResult(const MappingContainer& currentMapping, MappingStateTracker& stateTracker) noexcept -> TranslationResult
+	[[nodiscard]] inline auto GetResetTranslationResult(const MappingContainer& currentMapping, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> TranslationResult
 	{
 		return TranslationResult
 		{
@@ -323,25 +830,25 @@ namespace sds
 				if (currentMapping.OnReset)
 					currentMapping.OnReset();
 			},
-			.AdvanceStateFn = [&]()
+			.AdvanceStateFn = [&stateTracker, now]()
 			{
 				stateTracker.SetInitial();
-				stateTracker.LastSentTime.Reset();
+				stateTracker.LastSentTime.Reset(now);
 			},
 			.MappingVk = currentMapping.ButtonVirtualKeycode,
 			.ExclusivityGrouping = currentMapping.ExclusivityGrouping
 		};
 	}
 
-	[[nodiscard]] inline auto GetRepeatTranslationResult(const MappingContainer& currentMapping, MappingStateTracker& stateTracker) noexcept -> TranslationResult
+	[[nodiscard]] inline auto GetRepeatTranslationResult(const MappingContainer& currentMapping, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> TranslationResult
 	{
 		return TranslationResult
 		{
-			.OperationToPerform = [&]()
+			.OperationToPerform = [&currentMapping, &stateTracker, now]()
 			{
 				if (currentMapping.OnRepeat)
 					currentMapping.OnRepeat();
-				stateTracker.LastSentTime.Reset();
+				ResetRepeatTimer(currentMapping, stateTracker, now);
 			},
 			.AdvanceStateFn = [&]()
 			{
@@ -363,6 +870,7 @@ namespace sds
 			},
 			.AdvanceStateFn = [&]()
 			{
+				RestoreRepeatDelay(overtakenMapping, stateTracker);
 				stateTracker.SetUp();
 			},
 			.MappingVk = overtakenMapping.ButtonVirtualKeycode,
@@ -381,6 +889,7 @@ namespace sds
 			},
 			.AdvanceStateFn = [&]()
 			{
+				RestoreRepeatDelay(currentMapping, stateTracker);
 				stateTracker.SetUp();
 			},
 			.MappingVk = currentMapping.ButtonVirtualKeycode,
@@ -388,17 +897,17 @@ namespace sds
 		};
 	}
 
-	[[nodiscard]] inline auto GetInitialKeyDownTranslationResult(const MappingContainer& currentMapping, MappingStateTracker& stateTracker) noexcept -> TranslationResult
+	[[nodiscard]] inline auto GetInitialKeyDownTranslationResult(const MappingContainer& currentMapping, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> TranslationResult
 	{
 		return TranslationResult
 		{
-			.OperationToPerform = [&]()
+			.OperationToPerform = [&currentMapping, &stateTracker, now]()
 			{
 				if (currentMapping.OnDown)
 					currentMapping.OnDown();
 				// Reset timer after activation, to wait for elapsed before another next state translation is returned.
-				stateTracker.LastSentTime.Reset();
-				stateTracker.DelayBeforeFirstRepeat.Reset();
+				stateTracker.LastSentTime.Reset(now);
+				stateTracker.DelayBeforeFirstRepeat.Reset(now);
 			},
 			.AdvanceStateFn = [&]()
 			{
@@ -425,122 +934,250 @@ namespace sds
 	//}
 
 	/**
-	 * \brief For a single mapping, search the controller state update buffer and produce a TranslationResult appropriate to the current mapping state and controller state.
-	 * \param downKeys Wrapper class containing the results of a controller state update polling.
-	 * \param singleButton The mapping type for a single virtual key of the controller.
-	 * \returns Optional, <c>TranslationResult</c>
+	 * \brief	Membership test for the 'down' virtual keycodes of a state update, linear for a range of keycodes.
 	 */
 	template<typename Val_t>
-	[[nodiscard]] auto GetButtonTranslationForInitialToDown(const SmallVector_t<Val_t>& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker) noexcept -> std::optional<TranslationResult>
+	[[nodiscard]] constexpr bool IsVirtualKeyDown(const SmallVector_t<Val_t>& downKeys, const NotBoolIntegral_c auto vk) noexcept
 	{
-		using std::ranges::find;
+		return std::ranges::find(downKeys, static_cast<Val_t>(vk)) != std::ranges::cend(downKeys);
+	}
 
-		if (stateTracker.IsInitialState())
-		{
-			const auto findResult = find(downKeys, singleButton.ButtonVirtualKeycode);
-			// If VK *is* found in the down list, create the down translation.
-			if (std::end(downKeys) != findResult)
-				return std::make_optional<TranslationResult>(GetInitialKeyDownTranslationResult(singleButton, stateTracker));
-		}
-		return {};
+	/**
+	 * \brief	Membership test for the 'down' virtual keycodes of a state update, a single bit test for a KeySet.
+	 */
+	template<std::size_t Width_v>
+	[[nodiscard]] constexpr bool IsVirtualKeyDown(const KeySet<Width_v>& downKeys, const NotBoolIntegral_c auto vk) noexcept
+	{
+		return downKeys.Contains(vk);
 	}
 
-	template<typename Val_t>
-	[[nodiscard]] auto GetButtonTranslationForDownToRepeat(const SmallVector_t<Val_t>& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker) noexcept -> std::optional<TranslationResult>
+	// Predicates for each state transition, shared by the TranslationResult and TransitionRecord paths of the translator.
+
+	template<typename DownKeys_t>
+	[[nodiscard]] bool IsInitialToDown(const DownKeys_t& downKeys, const MappingContainer& singleButton, const MappingStateTracker& stateTracker) noexcept
 	{
-		using std::ranges::find;
+		// If VK *is* found in the down list, transition to down.
+		return stateTracker.IsInitialState() && IsVirtualKeyDown(downKeys, singleButton.ButtonVirtualKeycode);
+	}
 
+	template<typename DownKeys_t>
+	[[nodiscard]] bool IsDownToRepeat(const DownKeys_t& downKeys, const MappingContainer& singleButton, const MappingStateTracker& stateTracker, const TimePoint_t now) noexcept
+	{
 		const bool isDownAndUsesRepeat =
 			stateTracker.IsDown()
 			&& (singleButton.RepeatingKeyBehavior == RepeatType::Infinite
-				|| singleButton.RepeatingKeyBehavior == RepeatType::FirstOnly);
+				|| singleButton.RepeatingKeyBehavior == RepeatType::FirstOnly
+				|| singleButton.RepeatingKeyBehavior == RepeatType::Accelerating);
 
-		const bool isDelayElapsed = stateTracker.DelayBeforeFirstRepeat.IsElapsed();
+		// If VK *is* found in the down list, transition to repeat.
+		return isDownAndUsesRepeat
+			&& stateTracker.DelayBeforeFirstRepeat.IsElapsed(now)
+			&& IsVirtualKeyDown(downKeys, singleButton.ButtonVirtualKeycode);
+	}
 
-		if (isDownAndUsesRepeat && isDelayElapsed)
-		{
-			const auto findResult = find(downKeys, singleButton.ButtonVirtualKeycode);
-			// If VK *is* found in the down list, create the repeat translation.
-			if (std::cend(downKeys) != findResult)
-				return std::make_optional<TranslationResult>(GetRepeatTranslationResult(singleButton, stateTracker));
-		}
-		return {};
+	template<typename DownKeys_t>
+	[[nodiscard]] bool IsRepeatToRepeat(const DownKeys_t& downKeys, const MappingContainer& singleButton, const MappingStateTracker& stateTracker, const TimePoint_t now) noexcept
+	{
+		const bool isRepeatAndUsesInfinite = stateTracker.IsRepeating()
+			&& (singleButton.RepeatingKeyBehavior == RepeatType::Infinite || singleButton.RepeatingKeyBehavior == RepeatType::Accelerating);
+
+		// If VK *is* found in the down list, send another repeat.
+		return isRepeatAndUsesInfinite
+			&& stateTracker.LastSentTime.IsElapsed(now)
+			&& IsVirtualKeyDown(downKeys, singleButton.ButtonVirtualKeycode);
 	}
 
-	template<typename Val_t>
-	[[nodiscard]] auto GetButtonTranslationForRepeatToRepeat(const SmallVector_t<Val_t>& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker) noexcept -> std::optional<TranslationResult>
+	template<typename DownKeys_t>
+	[[nodiscard]] bool IsDownOrRepeatToUp(const DownKeys_t& downKeys, const MappingContainer& singleButton, const MappingStateTracker& stateTracker) noexcept
 	{
-		using std::ranges::find;
+		// If VK is not found in the down list, transition to up.
+		return (stateTracker.IsDown() || stateTracker.IsRepeating())
+			&& !IsVirtualKeyDown(downKeys, singleButton.ButtonVirtualKeycode);
+	}
 
-		const bool isRepeatAndUsesInfinite = stateTracker.IsRepeating() && singleButton.RepeatingKeyBehavior == RepeatType::Infinite;
-		if (isRepeatAndUsesInfinite && stateTracker.LastSentTime.IsElapsed())
-		{
-			const auto findResult = find(downKeys, singleButton.ButtonVirtualKeycode);
-			// If VK *is* found in the down list, create the repeat translation.
-			if (std::cend(downKeys) != findResult)
-				return std::make_optional<TranslationResult>(GetRepeatTranslationResult(singleButton, stateTracker));
-		}
+	[[nodiscard]] inline bool IsUpToInitial(const MappingStateTracker& stateTracker, const TimePoint_t now) noexcept
+	{
+		// if the timer has elapsed, update back to the initial state.
+		return stateTracker.IsUp() && stateTracker.LastSentTime.IsElapsed(now);
+	}
+
+	/**
+	 * \brief For a single mapping, search the controller state update buffer and produce a TranslationResult appropriate to the current mapping state and controller state.
+	 * \param downKeys Wrapper class containing the results of a controller state update polling.
+	 * \param singleButton The mapping type for a single virtual key of the controller.
+	 * \returns Optional, <c>TranslationResult</c>
+	 */
+	template<typename DownKeys_t>
+	[[nodiscard]] auto GetButtonTranslationForInitialToDown(const DownKeys_t& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> std::optional<TranslationResult>
+	{
+		if (IsInitialToDown(downKeys, singleButton, stateTracker))
+			return std::make_optional<TranslationResult>(GetInitialKeyDownTranslationResult(singleButton, stateTracker, now));
 		return {};
 	}
 
-	template<typename Val_t>
-	[[nodiscard]] auto GetButtonTranslationForDownOrRepeatToUp(const SmallVector_t<Val_t>& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker) noexcept -> std::optional<TranslationResult>
+	template<typename DownKeys_t>
+	[[nodiscard]] auto GetButtonTranslationForDownToRepeat(const DownKeys_t& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> std::optional<TranslationResult>
 	{
-		using std::ranges::find;
+		if (IsDownToRepeat(downKeys, singleButton, stateTracker, now))
+			return std::make_optional<TranslationResult>(GetRepeatTranslationResult(singleButton, stateTracker, now));
+		return {};
+	}
 
-		if (stateTracker.IsDown() || stateTracker.IsRepeating())
-		{
-			const auto findResult = find(downKeys, singleButton.ButtonVirtualKeycode);
-			// If VK is not found in the down list, create the up translation.
-			if (std::end(downKeys) == findResult)
-				return std::make_optional<TranslationResult>(GetKeyUpTranslationResult(singleButton, stateTracker));
-		}
+	template<typename DownKeys_t>
+	[[nodiscard]] auto GetButtonTranslationForRepeatToRepeat(const DownKeys_t& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> std::optional<TranslationResult>
+	{
+		if (IsRepeatToRepeat(downKeys, singleButton, stateTracker, now))
+			return std::make_optional<TranslationResult>(GetRepeatTranslationResult(singleButton, stateTracker, now));
+		return {};
+	}
+
+	template<typename DownKeys_t>
+	[[nodiscard]] auto GetButtonTranslationForDownOrRepeatToUp(const DownKeys_t& downKeys, const MappingContainer& singleButton, MappingStateTracker& stateTracker) noexcept -> std::optional<TranslationResult>
+	{
+		if (IsDownOrRepeatToUp(downKeys, singleButton, stateTracker))
+			return std::make_optional<TranslationResult>(GetKeyUpTranslationResult(singleButton, stateTracker));
 		return {};
 	}
 
 	// This is the reset translation
-	[[nodiscard]] inline auto GetButtonTranslationForUpToInitial(const MappingContainer& singleButton, MappingStateTracker& stateTracker) noexcept -> std::optional<TranslationResult>
+	[[nodiscard]] inline auto GetButtonTranslationForUpToInitial(const MappingContainer& singleButton, MappingStateTracker& stateTracker, const TimePoint_t now = Clock_t::now()) noexcept -> std::optional<TranslationResult>
 	{
-		// if the timer has elapsed, update back to the initial state.
-		if (stateTracker.IsUp() && stateTracker.LastSentTime.IsElapsed())
-		{
-			return std::make_optional<TranslationResult>(GetResetTranslationResult(singleButton, stateTracker));
-		}
+		if (IsUpToInitial(stateTracker, now))
+			return std::make_optional<TranslationResult>(GetResetTranslationResult(singleButton, stateTracker, now));
 		return {};
 	}
 
 	/**
-	* \brief  Optionally returns the indices at which a mapping that matches the 'vk' was found.
-	* \param vk Virtual keycode of the presumably 'down' key with which to match MappingContainer mappings.
-	* \param mappingsRange The range of MappingContainer mappings for which to return the index of a matching mapping.
-	*/
-	[[nodiscard]] inline auto GetMappingIndexForVk(const NotBoolIntegral_c auto vk, const std::span<const MappingContainer> mappingsRange) noexcept -> std::optional<Index_t>
+	 * \brief	For a single mapping, gets the state it should transition to given the state update, if any. The closure-free counterpart of the GetButtonTranslationFor* chain.
+	 * \returns	Optional, the <c>ActionState</c> to transition to, <c>ActionState::Init</c> being the reset.
+	 */
+	template<typename DownKeys_t>
+	[[nodiscard]] auto GetNextTransition(const DownKeys_t& downKeys, const MappingContainer& singleButton, const MappingStateTracker& stateTracker, const TimePoint_t now) noexcept -> std::optional<ActionState>
+	{
+		if (IsUpToInitial(stateTracker, now))
+			return ActionState::Init;
+		if (IsInitialToDown(downKeys, singleButton, stateTracker))
+			return ActionState::KeyDown;
+		if (IsDownToRepeat(downKeys, singleButton, stateTracker, now) || IsRepeatToRepeat(downKeys, singleButton, stateTracker, now))
+			return ActionState::KeyRepeat;
+		if (IsDownOrRepeatToUp(downKeys, singleButton, stateTracker))
+			return ActionState::KeyUp;
+		return {};
+	}
+
+	/**
+	 * \brief	Immutable lookup of the mapping index for a virtual keycode, built once from the mappings and shared by the classes that need it.
+	 * \remarks	When the keycodes span at most DirectRangeLimit values, a lookup is a single indexed load from a dense array (the usual case, keycodes are small),
+	 *	otherwise it is a binary search of a sorted flat array of keycode and index pairs. There is no hashing in either case.
+	 */
+	class VirtualKeyIndex
 	{
-		using std::ranges::find_if;
+		using Entry_t = std::pair<int32_t, Index_t>;
+		static constexpr Index_t NoMapping{ std::numeric_limits<Index_t>::max() };
+
+		int32_t m_minVk{};
+		// Direct table, indexed by (vk - m_minVk), NoMapping where there is no mapping. Empty if the sorted table is used.
+		SmallVector_t<Index_t> m_direct;
+		// Sorted by keycode, used when the keycodes are too sparse for the direct table.
+		SmallVector_t<Entry_t> m_sorted;
+		std::size_t m_size{};
+	public:
+		static constexpr std::size_t DirectRangeLimit{ 4096 };
 
-		const auto findResult = find_if(mappingsRange, [vk](const auto& e) { return e.ButtonVirtualKeycode == static_cast<decltype(e.ButtonVirtualKeycode)>(vk); });
-		const bool didFindResult = std::cend(mappingsRange) != findResult;
+		VirtualKeyIndex() = default;
 
-		[[unlikely]]
-		if (!didFindResult)
+		/**
+		 * \brief	Builds the index, the mapping keycodes must be unique.
+		 * \exception std::runtime_error if there are more mappings than Index_t can address.
+		 */
+		explicit VirtualKeyIndex(const std::span<const MappingContainer> mappings)
+			: m_size(mappings.size())
 		{
-			return {};
+			if (mappings.size() >= NoMapping)
+				throw std::runtime_error("Exception: Too many mappings for Index_t!");
+			if (mappings.empty())
+				return;
+
+			const auto [minIt, maxIt] = std::ranges::minmax_element(mappings, {}, &MappingContainer::ButtonVirtualKeycode);
+			m_minVk = minIt->ButtonVirtualKeycode;
+			const auto vkRange = static_cast<int64_t>(maxIt->ButtonVirtualKeycode) - m_minVk + 1;
+
+			if (vkRange <= static_cast<int64_t>(DirectRangeLimit))
+			{
+				m_direct.assign(static_cast<std::size_t>(vkRange), NoMapping);
+				for (std::size_t i{}; i < mappings.size(); ++i)
+					m_direct[static_cast<std::size_t>(mappings[i].ButtonVirtualKeycode - m_minVk)] = static_cast<Index_t>(i);
+			}
+			else
+			{
+				m_sorted.reserve(mappings.size());
+				for (std::size_t i{}; i < mappings.size(); ++i)
+					m_sorted.emplace_back(mappings[i].ButtonVirtualKeycode, static_cast<Index_t>(i));
+				std::ranges::sort(m_sorted, {}, &Entry_t::first);
+			}
 		}
 
-		return std::make_optional<Index_t>(static_cast<Index_t>(std::distance(mappingsRange.cbegin(), findResult)));
-	}
+		[[nodiscard]] auto Find(const NotBoolIntegral_c auto vk) const noexcept -> std::optional<Index_t>
+		{
+			if (!m_direct.empty())
+			{
+				const auto offset = static_cast<int64_t>(vk) - m_minVk;
+				if (offset < 0 || offset >= static_cast<int64_t>(m_direct.size()))
+					return {};
+				const auto index = m_direct[static_cast<std::size_t>(offset)];
+				if (index == NoMapping)
+					return {};
+				return index;
+			}
+			const auto findResult = std::ranges::lower_bound(m_sorted, static_cast<int64_t>(vk), {}, [](const Entry_t& e) { return static_cast<int64_t>(e.first); });
+			if (findResult == m_sorted.cend() || findResult->first != static_cast<int64_t>(vk))
+				return {};
+			return findResult->second;
+		}
+
+		[[nodiscard]] bool Contains(const NotBoolIntegral_c auto vk) const noexcept
+		{
+			return Find(vk).has_value();
+		}
+
+		[[nodiscard]] auto size() const noexcept -> std::size_t
+		{
+			return m_size;
+		}
+
+		[[nodiscard]] bool IsDirect() const noexcept
+		{
+			return !m_direct.empty();
+		}
+	};
+	static_assert(std::copyable<VirtualKeyIndex>);
 
 	[[nodiscard]] constexpr auto IsMappingInRange(const NotBoolIntegral_c auto vkToFind, const std::ranges::range auto& downVirtualKeys) noexcept -> bool
 	{
 		return std::ranges::any_of(downVirtualKeys, [vkToFind](const auto vk) { return vk == vkToFind; });
 	}
 
+	template<std::size_t Width_v>
+	[[nodiscard]] constexpr auto IsMappingInRange(const NotBoolIntegral_c auto vkToFind, const KeySet<Width_v>& downVirtualKeys) noexcept -> bool
+	{
+		return downVirtualKeys.Contains(vkToFind);
+	}
+
 	constexpr auto GetErasedRange(const std::ranges::range auto& theRange, const std::ranges::range auto& theValues) noexcept -> std::vector<int32_t>
 	{
 		auto copied = theRange | std::views::filter([&](const auto& elem) { return !IsMappingInRange(elem, theValues); });
 		return { std::ranges::begin(copied), std::ranges::end(copied) };
 	}
 
+	template<std::size_t Width_v>
+	constexpr auto GetErasedRange(const KeySet<Width_v>& theRange, const std::ranges::range auto& theValues) noexcept -> KeySet<Width_v>
+	{
+		auto erased = theRange;
+		for (const auto vk : theValues)
+			erased.Reset(vk);
+		return erased;
+	}
+
 	/**
 	 * \brief	Checks a list of mappings for having multiple mappings mapped to a single controller button.
 	 * \param	mappingsList Span of controller button to action mappings.
@@ -570,6 +1207,25 @@ namespace sds
 		return !std::ranges::any_of(mappingsList, [](const auto vk) { return vk == 0; }, &MappingContainer::ButtonVirtualKeycode);
 	}
 
+	/**
+	 * \brief	Compile-time counterpart of AreMappingsUniquePerVk and AreMappingVksNonZero for a MappingDescription table, for use in a static_assert.
+	 */
+	template<typename Action_t, std::size_t Size_v>
+	[[nodiscard]] constexpr bool AreDescriptionsValid(const std::array<MappingDescription<Action_t>, Size_v>& table) noexcept
+	{
+		for (std::size_t i{}; i < table.size(); ++i)
+		{
+			if (table[i].ButtonVirtualKeycode == 0)
+				return false;
+			for (std::size_t j{ i + 1 }; j < table.size(); ++j)
+			{
+				if (table[i].ButtonVirtualKeycode == table[j].ButtonVirtualKeycode)
+					return false;
+			}
+		}
+		return true;
+	}
+
 	/**
 	 * \brief Used to determine if the MappingStateManager is in a state that would require some cleanup before destruction.
 	 * \remarks If you add another state for the mapping, make sure to update this.
@@ -580,6 +1236,25 @@ namespace sds
 		return mapping.IsDown() || mapping.IsRepeating();
 	}
 
+	/**
+	 * \brief	Gets the point in time at which a mapping will next undergo a timer driven state change (first repeat, repeat, or reset), if any.
+	 * \remarks	Mirrors the timer checks made in the GetButtonTranslationFor* functions, if you add a timed transition make sure to update this.
+	 * \return	Empty optional if the mapping's next state change can only come from a new key-state update.
+	 */
+	[[nodiscard]] inline auto GetMappingDeadline(const MappingContainer& mapping, const MappingStateTracker& stateTracker) noexcept -> std::optional<TimePoint_t>
+	{
+		const bool usesRepeat = mapping.RepeatingKeyBehavior != RepeatType::None;
+		const bool usesInfiniteRepeat = mapping.RepeatingKeyBehavior == RepeatType::Infinite || mapping.RepeatingKeyBehavior == RepeatType::Accelerating;
+
+		if (stateTracker.IsUp())
+			return stateTracker.LastSentTime.GetDeadline();
+		if (stateTracker.IsDown() && usesRepeat)
+			return stateTracker.DelayBeforeFirstRepeat.GetDeadline();
+		if (stateTracker.IsRepeating() && usesInfiniteRepeat)
+			return stateTracker.LastSentTime.GetDeadline();
+		return {};
+	}
+
 #pragma endregion Algos_For_Translator
 
 	/**
@@ -596,6 +1271,7 @@ namespace sds
 		static_assert(MappingRange_c<MappingVector_t>);
 		MappingStateVector_t m_mappingStates;
 		std::shared_ptr<MappingVector_t> m_mappings;
+		std::shared_ptr<const VirtualKeyIndex> m_keyIndex;
 	public:
 		Translator() = delete; // no default
 		Translator(const Translator& other) = delete; // no copy
@@ -615,7 +1291,8 @@ namespace sds
 		{
 			if (!AreMappingsUniquePerVk(*m_mappings) || !AreMappingVksNonZero(*m_mappings))
 				throw std::runtime_error("Exception: More than 1 mapping per VK!");
-			
+
+			m_keyIndex = std::make_shared<const VirtualKeyIndex>(*m_mappings);
 			m_mappingStates.resize(m_mappings->size());
 			// Zip returns a tuple of refs to the types.
 			for (auto zipped : std::views::zip(*m_mappings, m_mappingStates))
@@ -627,43 +1304,224 @@ namespace sds
 			}
 		}
 	public:
-		[[nodiscard]] auto operator()(const SmallVector_t<int32_t>& stateUpdate) noexcept -> TranslationPack
+		/**
+		 * \remarks	Every function that reads the time takes it as a defaulted parameter, the default is a single clock read for the whole update.
+		 *	Pass the same snapshot to the update and the subsequent <c>Execute(...)</c>, or pass <c>ManualClock::Now()</c> for deterministic replay.
+		 */
+		[[nodiscard]] auto operator()(const SmallVector_t<int32_t>& stateUpdate, const TimePoint_t now = Clock_t::now()) -> TranslationPack
+		{
+			return GetUpdatedState(stateUpdate, now);
+		}
+
+		template<std::size_t Width_v>
+		[[nodiscard]] auto operator()(const KeySet<Width_v>& stateUpdate, const TimePoint_t now = Clock_t::now()) -> TranslationPack
 		{
-			return GetUpdatedState(stateUpdate);
+			return GetUpdatedState(stateUpdate, now);
 		}
 
-		[[nodiscard]] auto GetUpdatedState(const SmallVector_t<int32_t>& stateUpdate) noexcept -> TranslationPack
+		[[nodiscard]] auto GetUpdatedState(const SmallVector_t<int32_t>& stateUpdate, const TimePoint_t now = Clock_t::now()) -> TranslationPack
 		{
 			TranslationPack translations;
-			for (auto elem : std::views::zip(*m_mappings, m_mappingStates))
+			TranslateState(stateUpdate, translations, now);
+			return translations;
+		}
+
+		/**
+		 * \brief	Bitmask key-state overload, per mapping membership tests are O(1) rather than a search of the down keys.
+		 */
+		template<std::size_t Width_v>
+		[[nodiscard]] auto GetUpdatedState(const KeySet<Width_v>& stateUpdate, const TimePoint_t now = Clock_t::now()) -> TranslationPack
+		{
+			TranslationPack translations;
+			TranslateState(stateUpdate, translations, now);
+			return translations;
+		}
+
+		/**
+		 * \brief	Fills a caller owned pack with the translations for the state update, the pack is cleared first.
+		 * \remarks	Re-using one pack obtained from <c>MakeTranslationPack()</c> for every update means a steady-state update performs no allocations.
+		 */
+		void GetUpdatedState(const SmallVector_t<int32_t>& stateUpdate, TranslationPack& translations, const TimePoint_t now = Clock_t::now())
+		{
+			TranslateState(stateUpdate, translations, now);
+		}
+
+		template<std::size_t Width_v>
+		void GetUpdatedState(const KeySet<Width_v>& stateUpdate, TranslationPack& translations, const TimePoint_t now = Clock_t::now())
+		{
+			TranslateState(stateUpdate, translations, now);
+		}
+
+		/**
+		 * \brief	Creates a pack with capacity reserved for every mapping, for use with the caller owned pack overloads of GetUpdatedState.
+		 */
+		[[nodiscard]] auto MakeTranslationPack() const -> TranslationPack
+		{
+			TranslationPack translations;
+			translations.Reserve(m_mappings->size());
+			return translations;
+		}
+
+		/**
+		 * \brief	Closure-free counterpart of GetUpdatedState, fills a caller owned pack with TransitionRecords for the state update, the pack is cleared first.
+		 * \remarks	Nothing is performed until the records are passed to <c>Execute(...)</c>, or the state is advanced with <c>AdvanceState(...)</c>.
+		 */
+		void GetUpdatedTransitions(const SmallVector_t<int32_t>& stateUpdate, TransitionPack& transitions, const TimePoint_t now = Clock_t::now())
+		{
+			TranslateTransitions(stateUpdate, transitions, now);
+		}
+
+		template<std::size_t Width_v>
+		void GetUpdatedTransitions(const KeySet<Width_v>& stateUpdate, TransitionPack& transitions, const TimePoint_t now = Clock_t::now())
+		{
+			TranslateTransitions(stateUpdate, transitions, now);
+		}
+
+		/**
+		 * \brief	Creates a pack with capacity reserved for every mapping, for use with GetUpdatedTransitions.
+		 */
+		[[nodiscard]] auto MakeTransitionPack() const -> TransitionPack
+		{
+			TransitionPack transitions;
+			transitions.Reserve(m_mappings->size());
+			return transitions;
+		}
+
+		/**
+		 * \brief	Performs the record, calling the mapping function for the transition (if any) then advancing the mapping state.
+		 */
+		void Execute(const TransitionRecord record, const TimePoint_t now = Clock_t::now())
+		{
+			CallMappingFunction(record);
+			AdvanceState(record, now);
+		}
+
+		/**
+		 * \brief	Performs every record in the pack, key-ups then key-downs then repeats then resets, the same order as TranslationPack.
+		 */
+		void Execute(const TransitionPack& transitions, const TimePoint_t now = Clock_t::now())
+		{
+			for (const auto record : transitions.UpRequests)
+				Execute(record, now);
+			for (const auto record : transitions.DownRequests)
+				Execute(record, now);
+			for (const auto record : transitions.RepeatRequests)
+				Execute(record, now);
+			for (const auto record : transitions.UpdateRequests)
+				Execute(record, now);
+		}
+
+		/**
+		 * \brief	Performs every record in the pack with the dispatch function in place of the mapping functions, in the same order as Execute(pack), advancing the state after each.
+		 * \remarks	For a translator made from a MappingDescription table, the dispatch can index the table with the record's MappingIndex and switch on the action.
+		 */
+		template<typename Dispatch_t> requires std::invocable<Dispatch_t&, TransitionRecord>
+		void Execute(const TransitionPack& transitions, Dispatch_t&& dispatch, const TimePoint_t now = Clock_t::now())
+		{
+			const auto performAll = [&](const auto& records)
 			{
-				auto& [mapping, mappingState] = elem;
-				if (const auto upToInitial = GetButtonTranslationForUpToInitial(mapping, mappingState))
+				for (const auto record : records)
 				{
-					translations.UpdateRequests.push_back(*upToInitial);
+					dispatch(record);
+					AdvanceState(record, now);
 				}
-				else if (const auto initialToDown = GetButtonTranslationForInitialToDown(stateUpdate, mapping, mappingState))
-				{
-					// Advance to next state.
-					translations.DownRequests.push_back(*initialToDown);
-				}
-				else if (const auto downToFirstRepeat = GetButtonTranslationForDownToRepeat(stateUpdate, mapping, mappingState))
-				{
-					translations.RepeatRequests.push_back(*downToFirstRepeat);
-				}
-				else if (const auto repeatToRepeat = GetButtonTranslationForRepeatToRepeat(stateUpdate, mapping, mappingState))
+			};
+			performAll(transitions.UpRequests);
+			performAll(transitions.DownRequests);
+			performAll(transitions.RepeatRequests);
+			performAll(transitions.UpdateRequests);
+		}
+
+		/**
+		 * \brief	Performs the transitions for a stream of key edges, in order, each with the time of its edge.
+		 * \remarks	Every edge with a mapping produces its OnDown/OnUp exactly once: a down edge for a mapping still waiting on its reset delay
+		 *	resets it first, a down edge for a mapping already down (or an up edge for one not down) is a duplicate and is ignored.
+		 *	Level updates may be interleaved with edge processing, the next <c>GetUpdatedState(...)</c> continues from the resulting mapping states.
+		 *	Edges are not filtered by an OvertakingFilter.
+		 */
+		void ProcessEdgeEvents(const std::span<const KeyEdgeEvent> edges)
+		{
+			ProcessEdgeEvents(edges, [this](const TransitionRecord record) { CallMappingFunction(record); });
+		}
+
+		/**
+		 * \brief	As ProcessEdgeEvents(edges), with the dispatch function in place of the mapping functions, see <c>Execute(pack, dispatch)</c>.
+		 */
+		template<typename Dispatch_t> requires std::invocable<Dispatch_t&, TransitionRecord>
+		void ProcessEdgeEvents(const std::span<const KeyEdgeEvent> edges, Dispatch_t&& dispatch)
+		{
+			for (const auto& edge : edges)
+			{
+				const auto index = m_keyIndex->Find(edge.VirtualKeycode);
+				if (!index)
+					continue;
+
+				const auto& stateTracker = m_mappingStates[*index];
+				const auto perform = [&](const ActionState transition)
+					{
+						const TransitionRecord record{ *index, transition };
+						dispatch(record);
+						AdvanceState(record, edge.Time);
+					};
+				if (edge.IsDown)
 				{
-					translations.RepeatRequests.push_back(*repeatToRepeat);
+					if (stateTracker.IsUp())
+						perform(ActionState::Init);
+					if (stateTracker.IsInitialState())
+						perform(ActionState::KeyDown);
 				}
-				else if (const auto repeatToUp = GetButtonTranslationForDownOrRepeatToUp(stateUpdate, mapping, mappingState))
+				else if (stateTracker.IsDown() || stateTracker.IsRepeating())
 				{
-					translations.UpRequests.push_back(*repeatToUp);
+					perform(ActionState::KeyUp);
 				}
 			}
-			return translations;
 		}
 
-		[[nodiscard]] auto GetCleanupActions() noexcept -> SmallVector_t<TranslationResult>
+		/**
+		 * \brief	Advances the mapping state for the record without calling the mapping function, for callers that dispatch the action themselves.
+		 */
+		void AdvanceState(const TransitionRecord record, const TimePoint_t now = Clock_t::now())
+		{
+			const auto& mapping = (*m_mappings)[record.MappingIndex];
+			auto& stateTracker = m_mappingStates[record.MappingIndex];
+			switch (record.Transition)
+			{
+			case ActionState::KeyDown:
+				// Reset timer after activation, to wait for elapsed before another next state translation is returned.
+				stateTracker.LastSentTime.Reset(now);
+				stateTracker.DelayBeforeFirstRepeat.Reset(now);
+				stateTracker.SetDown();
+				break;
+			case ActionState::KeyRepeat:
+				ResetRepeatTimer(mapping, stateTracker, now);
+				stateTracker.SetRepeat();
+				break;
+			case ActionState::KeyUp:
+				RestoreRepeatDelay(mapping, stateTracker);
+				stateTracker.SetUp();
+				break;
+			case ActionState::Init:
+				stateTracker.SetInitial();
+				stateTracker.LastSentTime.Reset(now);
+				break;
+			}
+		}
+
+		/**
+		 * \brief	Closure-free counterpart of GetCleanupActions, key-up records for every mapping that is down or repeating.
+		 */
+		[[nodiscard]] auto GetCleanupTransitions() const -> SmallVector_t<TransitionRecord>
+		{
+			SmallVector_t<TransitionRecord> transitions;
+			for (std::size_t i{}; i < m_mappingStates.size(); ++i)
+			{
+				if (DoesMappingNeedCleanup(m_mappingStates[i]))
+					transitions.push_back({ static_cast<Index_t>(i), ActionState::KeyUp });
+			}
+			return transitions;
+		}
+
+		[[nodiscard]] auto GetCleanupActions() -> SmallVector_t<TranslationResult>
 		{
 			SmallVector_t<TranslationResult> translations;
 			for (auto elem : std::views::zip(*m_mappings, m_mappingStates))
@@ -677,10 +1535,118 @@ namespace sds
 			return translations;
 		}
 
+		/**
+		 * \brief	Gets the earliest point in time at which any mapping has a timer driven state change pending (first repeat, repeat, or reset).
+		 * \remarks	Allows a driver loop to sleep until this deadline, or until the key-state changes, rather than polling GetUpdatedState.
+		 * \return	Empty optional when no mapping is waiting on a timer, i.e. only a new key-state update can produce a translation.
+		 */
+		[[nodiscard]] auto GetNextDeadline() const noexcept -> std::optional<TimePoint_t>
+		{
+			std::optional<TimePoint_t> nextDeadline;
+			for (auto elem : std::views::zip(*m_mappings, m_mappingStates))
+			{
+				const auto& [mapping, mappingState] = elem;
+				const auto mappingDeadline = GetMappingDeadline(mapping, mappingState);
+				if (mappingDeadline && (!nextDeadline || *mappingDeadline < *nextDeadline))
+					nextDeadline = mappingDeadline;
+			}
+			return nextDeadline;
+		}
+
 		[[nodiscard]] auto GetMappingsRange() const noexcept -> std::shared_ptr<const MappingVector_t>
 		{
 			return m_mappings;
 		}
+
+		/**
+		 * \brief	The keycode to mapping index lookup for the mappings, built once at construction, for sharing with e.g. the OvertakingFilter.
+		 */
+		[[nodiscard]] auto GetKeyIndex() const noexcept -> std::shared_ptr<const VirtualKeyIndex>
+		{
+			return m_keyIndex;
+		}
+
+		/**
+		 * \brief	Calls the mapping function for the record's transition (if any), without advancing the mapping state.
+		 * \remarks	For a dispatch function passed to <c>Execute(pack, dispatch)</c> or <c>ProcessEdgeEvents(edges, dispatch)</c> that adds to the mapping functions.
+		 */
+		void CallMappingFunction(const TransitionRecord record) const
+		{
+			CallMappingFunction(GetMappingAt(record.MappingIndex), record.Transition);
+		}
+
+		/**
+		 * \brief	Calls the mapping function for the transition (if any), for a mapping held outside a Translator, e.g. by the SoaTranslator.
+		 */
+		static void CallMappingFunction(const MappingContainer& mapping, const ActionState transition)
+		{
+			switch (transition)
+			{
+			case ActionState::KeyDown:
+				if (mapping.OnDown)
+					mapping.OnDown();
+				break;
+			case ActionState::KeyRepeat:
+				if (mapping.OnRepeat)
+					mapping.OnRepeat();
+				break;
+			case ActionState::KeyUp:
+				if (mapping.OnUp)
+					mapping.OnUp();
+				break;
+			case ActionState::Init:
+				if (mapping.OnReset)
+					mapping.OnReset();
+				break;
+			}
+		}
+	private:
+		[[nodiscard]] auto GetMappingAt(const Index_t index) const noexcept -> const MappingContainer&
+		{
+			assert(index < m_mappings->size());
+			return (*m_mappings)[index];
+		}
+
+		void TranslateTransitions(const auto& stateUpdate, TransitionPack& transitions, const TimePoint_t now)
+		{
+			transitions.Clear();
+			for (std::size_t i{}; i < m_mappingStates.size(); ++i)
+			{
+				const auto index = static_cast<Index_t>(i);
+				if (const auto nextState = GetNextTransition(stateUpdate, GetMappingAt(index), m_mappingStates[i], now))
+					transitions.Add({ index, *nextState });
+			}
+		}
+
+		void TranslateState(const auto& stateUpdate, TranslationPack& translations, const TimePoint_t now)
+		{
+			translations.Clear();
+			for (auto elem : std::views::zip(*m_mappings, m_mappingStates))
+			{
+				auto& [mapping, mappingState] = elem;
+				if (auto upToInitial = GetButtonTranslationForUpToInitial(mapping, mappingState, now))
+				{
+					translations.UpdateRequests.push_back(std::move(*upToInitial));
+				}
+				else if (auto initialToDown = GetButtonTranslationForInitialToDown(stateUpdate, mapping, mappingState, now))
+				{
+					// Advance to next state.
+					translations.DownRequests.push_back(std::move(*initialToDown));
+				}
+				else if (auto downToFirstRepeat = GetButtonTranslationForDownToRepeat(stateUpdate, mapping, mappingState, now))
+				{
+					translations.RepeatRequests.push_back(std::move(*downToFirstRepeat));
+				}
+				else if (auto repeatToRepeat = GetButtonTranslationForRepeatToRepeat(stateUpdate, mapping, mappingState, now))
+				{
+					translations.RepeatRequests.push_back(std::move(*repeatToRepeat));
+				}
+				else if (auto repeatToUp = GetButtonTranslationForDownOrRepeatToUp(stateUpdate, mapping, mappingState))
+				{
+					translations.UpRequests.push_back(std::move(*repeatToUp));
+				}
+			}
+		}
 	};
 	static_assert(InputTranslator_c<Translator> == true);
 	static_assert(std::movable<Translator> == true);
@@ -810,24 +1776,21 @@ namespace sds
 	{
 		using VirtualCode_t = int32_t; 
 
-		std::unordered_set<VirtualCode_t> m_allVirtualKeycodes; // Order does not match mappings
 		// const ptr to mappings
 		std::shared_ptr<const SmallVector_t<MappingContainer>> m_mappings;
+		// keycode to mapping index, shared with the translator.
+		std::shared_ptr<const VirtualKeyIndex> m_keyIndex;
 
-		// map of grouping value to GroupActivationInfo container.
-		std::unordered_map<GrpVal_t, GroupInfo_t> m_groupMap;
-		// Mapping of grouping value to mapping indices.
-		std::unordered_map<GrpVal_t, std::set<VirtualCode_t>> m_groupToVkMap;
-		
-		std::unordered_map<int32_t, Index_t> m_vkToIndexMap;
+		// GroupActivationInfo container per exclusivity grouping value.
+		SmallVector_t<GroupInfo_t> m_groups;
+		// Index into m_groups for each mapping, by mapping index. Only meaningful for mappings with an exclusivity grouping.
+		SmallVector_t<Index_t> m_mappingGroupSlots;
 	public:
 		OvertakingFilter() noexcept = delete;
 
 		explicit OvertakingFilter(const InputTranslator_c auto& translator) noexcept
 		{
-			auto pMappings = translator.GetMappingsRange();
-
-			SetMappingRange(pMappings);
+			SetMappingRange(translator.GetMappingsRange(), translator.GetKeyIndex());
 		}
 
 		// This function is used to filter the controller state updates before they are sent to the translator.
@@ -841,9 +1804,44 @@ namespace sds
 			//sort(stateUpdate, std::ranges::less{}); // TODO <-- problem for the (current) unit testing, optional anyway
 
 			// Filters out VKs that don't have any corresponding mapping.
-			auto filteredUpdateView = stateUpdate | filter([this](const auto vk) { return m_allVirtualKeycodes.contains(vk); });
+			auto filteredUpdateView = stateUpdate | filter([this](const auto vk) { return m_keyIndex->Contains(vk); });
 			const std::vector<int32_t> filteredStateUpdate = { filteredUpdateView.cbegin(), filteredUpdateView.cend() };
 
+			return FilterButtonState(filteredStateUpdate, stateUpdate);
+		}
+
+		/**
+		 * \brief	Bitmask key-state overload, the filtered result is returned as a KeySet of the same width.
+		 */
+		template<std::size_t Width_v>
+		[[nodiscard]] auto GetFilteredButtonState(const KeySet<Width_v>& stateUpdate) noexcept -> KeySet<Width_v>
+		{
+			// Filters out VKs that don't have any corresponding mapping.
+			auto filteredStateUpdate = stateUpdate;
+			for (const auto vk : stateUpdate)
+			{
+				if (!m_keyIndex->Contains(vk))
+					filteredStateUpdate.Reset(vk);
+			}
+
+			return FilterButtonState(filteredStateUpdate, stateUpdate);
+		}
+
+		auto operator()(const SmallVector_t<VirtualCode_t>& stateUpdate) noexcept -> SmallVector_t<VirtualCode_t>
+		{
+			return GetFilteredButtonState(stateUpdate);
+		}
+
+		template<std::size_t Width_v>
+		auto operator()(const KeySet<Width_v>& stateUpdate) noexcept -> KeySet<Width_v>
+		{
+			return GetFilteredButtonState(stateUpdate);
+		}
+	private:
+		// Pre: VKs in the filtered state update do have a mapping.
+		template<typename StateRange_t>
+		[[nodiscard]] auto FilterButtonState(const StateRange_t& filteredStateUpdate, const StateRange_t& stateUpdate) noexcept -> StateRange_t
+		{
 			const auto uniqueGrouped = GetNonUniqueGroupElements(filteredStateUpdate);
 
 			const auto filteredForDown = FilterDownTranslation(uniqueGrouped);
@@ -856,19 +1854,12 @@ namespace sds
 			return filteredForDown;
 		}
 
-		auto operator()(const SmallVector_t<VirtualCode_t>& stateUpdate) noexcept -> SmallVector_t<VirtualCode_t>
-		{
-			return GetFilteredButtonState(stateUpdate);
-		}
-	private:
-
-		void SetMappingRange(const std::shared_ptr<const SmallVector_t<MappingContainer>>& mappingsList) noexcept
+		void SetMappingRange(const std::shared_ptr<const SmallVector_t<MappingContainer>>& mappingsList, const std::shared_ptr<const VirtualKeyIndex>& keyIndex) noexcept
 		{
 			m_mappings = mappingsList;
-			m_allVirtualKeycodes = {};
-			m_groupMap = {};
-			m_groupToVkMap = {};
-			m_vkToIndexMap = {};
+			m_keyIndex = keyIndex;
+			m_groups = {};
+			m_mappingGroupSlots = {};
 
 			BuildAllMemos(m_mappings);
 		}
@@ -878,35 +1869,31 @@ namespace sds
 		{
 			using std::views::enumerate;
 
+			SmallVector_t<GrpVal_t> groupValues;
+			m_mappingGroupSlots.resize(mappingsList->size());
 			for (const auto& [index, elem] : enumerate(*mappingsList))
 			{
-				// all vk set
-				m_allVirtualKeycodes.insert(elem.ButtonVirtualKeycode);
-				m_vkToIndexMap[elem.ButtonVirtualKeycode] = static_cast<Index_t>(index);
-
 				if (elem.ExclusivityGrouping)
 				{
-					// group to group info map
-					m_groupMap[elem.ExclusivityGrouping.value()] = {};
-					// group to vk map
-					m_groupToVkMap[elem.ExclusivityGrouping.value()].insert(elem.ButtonVirtualKeycode);
+					// mapping to group info slot, one slot per distinct grouping value
+					const auto findResult = std::ranges::find(groupValues, elem.ExclusivityGrouping.value());
+					m_mappingGroupSlots[index] = static_cast<Index_t>(std::distance(groupValues.begin(), findResult));
+					if (findResult == groupValues.end())
+						groupValues.push_back(elem.ExclusivityGrouping.value());
 				}
 			}
+			m_groups.resize(groupValues.size());
 		}
 
-		[[nodiscard]] auto FilterDownTranslation(const SmallVector_t<VirtualCode_t>& stateUpdate) noexcept -> SmallVector_t<VirtualCode_t>
+		template<typename StateRange_t>
+		[[nodiscard]] auto FilterDownTranslation(const StateRange_t& stateUpdate) noexcept -> StateRange_t
 		{
 			using std::views::filter;
 			using std::views::transform;
 
 			const auto vkToMappingIndex = [&](const auto vk) -> std::optional<Index_t>
 				{
-					using std::ranges::find_if;
-					if (m_allVirtualKeycodes.contains(vk))
-					{
-						return std::make_optional<Index_t>(m_vkToIndexMap[vk]);
-					}
-					return {};
+					return m_keyIndex->Find(vk);
 				};
 			const auto optWithValueAndGroup = [&](const auto opt) -> bool
 				{
@@ -924,7 +1911,7 @@ namespace sds
 			for (const auto& mappingIndex : stateUpdateCopy | transform(vkToMappingIndex) | filter(optWithValueAndGroup) | transform(removeOpt))
 			{
 				auto& currentMapping = GetMappingAt(mappingIndex);
-				auto& currentGroup = m_groupMap[*currentMapping.ExclusivityGrouping];
+				auto& currentGroup = GetGroupForMapping(mappingIndex);
 
 				const auto& [shouldFilter, upOpt] = currentGroup.UpdateForNewMatchingGroupingDown(currentMapping.ButtonVirtualKeycode);
 				if (shouldFilter)
@@ -941,9 +1928,8 @@ namespace sds
 		}
 
 		// it will process only one key per ex. group per iteration. The others will be filtered out and handled on the next iteration.
-		void FilterUpTranslation(const SmallVector_t<VirtualCode_t>& stateUpdate) noexcept
+		void FilterUpTranslation(const auto& stateUpdate) noexcept
 		{
-			using std::views::filter;
 			// filters for all mappings of interest per the current 'down' VK buffer (the UP mappings in this case).
 			const auto exGroupAndNotInUpdatePred = [&](const auto& currentMapping)
 				{
@@ -952,10 +1938,14 @@ namespace sds
 					return hasValue && notInUpdate;
 				};
 
-			for (const auto& currentMapping : (*m_mappings) | filter(exGroupAndNotInUpdatePred))
+			for (std::size_t mappingIndex{}; mappingIndex < m_mappings->size(); ++mappingIndex)
 			{
-				auto& currentGroup = m_groupMap[*currentMapping.ExclusivityGrouping];
-				currentGroup.UpdateForNewMatchingGroupingUp(currentMapping.ButtonVirtualKeycode);
+				const auto& currentMapping = GetMappingAt(mappingIndex);
+				if (exGroupAndNotInUpdatePred(currentMapping))
+				{
+					auto& currentGroup = GetGroupForMapping(mappingIndex);
+					currentGroup.UpdateForNewMatchingGroupingUp(currentMapping.ButtonVirtualKeycode);
+				}
 			}
 		}
 
@@ -967,31 +1957,37 @@ namespace sds
 
 		[[nodiscard]] constexpr auto GetMappingForVk(const NotBoolIntegral_c auto vk) noexcept -> const MappingContainer&
 		{
-			auto ind = GetMappingIndexForVk(vk, *m_mappings);
+			auto ind = m_keyIndex->Find(vk);
 			assert(ind.has_value());
 			return GetMappingAt(*ind);
 		}
 
+		// Pre: the mapping has an exclusivity grouping.
+		[[nodiscard]] auto GetGroupForMapping(const NotBoolIntegral_c auto index) noexcept -> GroupInfo_t&
+		{
+			assert(GetMappingAt(index).ExclusivityGrouping.has_value());
+			return m_groups[m_mappingGroupSlots[static_cast<Index_t>(index)]];
+		}
+
 		// Pre: VKs in state update do have a mapping.
-		[[nodiscard]] auto GetNonUniqueGroupElements(const SmallVector_t<int32_t>& stateUpdate) noexcept -> SmallVector_t<int32_t>
+		template<typename StateRange_t>
+		[[nodiscard]] auto GetNonUniqueGroupElements(const StateRange_t& stateUpdate) noexcept -> StateRange_t
 		{
 			using std::ranges::find, std::ranges::cend;
-			using StateRange_t = std::remove_cvref_t<decltype(stateUpdate)>;
 
 			SmallVector_t<GrpVal_t> groupingValueBuffer;
-			StateRange_t virtualKeycodesToRemove;
-			groupingValueBuffer.reserve(stateUpdate.size());
-			virtualKeycodesToRemove.reserve(stateUpdate.size());
+			SmallVector_t<VirtualCode_t> virtualKeycodesToRemove;
 
 			for (const auto vk : stateUpdate)
 			{
-				const auto mappingIndex = m_vkToIndexMap[vk];
-				const auto& foundMappingForVk = GetMappingAt(mappingIndex);
+				const auto mappingIndex = m_keyIndex->Find(vk);
+				assert(mappingIndex.has_value());
+				const auto& foundMappingForVk = GetMappingAt(*mappingIndex);
 
 				if (foundMappingForVk.ExclusivityGrouping)
 				{
 					const auto grpVal = foundMappingForVk.ExclusivityGrouping.value();
-					auto& currentGroup = m_groupMap[grpVal];
+					auto& currentGroup = GetGroupForMapping(*mappingIndex);
 					if (!currentGroup.IsMappingActivatedOrOvertaken(vk))
 					{
 						const auto groupingFindResult = find(groupingValueBuffer, grpVal);
@@ -0,0 +1,139 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "Logger.h"
+
+namespace asio = boost::asio;
+namespace ssl = boost::asio::ssl;
+
+/**
+ * \brief	TLS handshake counters, full and resumed (an abbreviated handshake re-using a session from an earlier connection).
+ *	Updated with relaxed atomics so they can be read from any thread.
+ */
+struct TlsHandshakeMetrics
+{
+	std::atomic<uint64_t> FullHandshakes{};
+	std::atomic<uint64_t> ResumedHandshakes{};
+	std::atomic<uint64_t> TotalFullHandshakeMicros{};
+	std::atomic<uint64_t> TotalResumedHandshakeMicros{};
+
+	void RecordHandshake(const bool wasResumed, const std::chrono::steady_clock::duration handshakeTime) noexcept
+	{
+		const auto micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(handshakeTime).count());
+		(wasResumed ? ResumedHandshakes : FullHandshakes).fetch_add(1, std::memory_order_relaxed);
+		(wasResumed ? TotalResumedHandshakeMicros : TotalFullHandshakeMicros).fetch_add(micros, std::memory_order_relaxed);
+	}
+};
+
+// get global TLS handshake metrics instance
+inline TlsHandshakeMetrics& GetTlsHandshakeMetricsInstance()
+{
+	static TlsHandshakeMetrics instance;
+	return instance;
+}
+
+/**
+ * \brief	The client's TLS context, and the last TLS session the server gave it, offered on the next handshake with the same host
+ *	so that a reconnect resumes the session instead of a full handshake (no certificate exchange or key agreement signature).
+ * \remarks	Outlives the connections, a reconnect re-uses the context. New sessions (TLS 1.2 session ids or tickets, TLS 1.3 tickets,
+ *	which arrive after the handshake) are taken from OpenSSL's new session callback. A TLS 1.3 ticket is offered once, the server
+ *	sends a new one on each connection. Used by the client thread only.
+ */
+class TlsClientContext
+{
+	ssl::context m_context{ ssl::context::tlsv12_client };
+	std::string m_sessionHost;
+	SSL_SESSION* m_session{};
+public:
+	TlsClientContext()
+	{
+		m_context.set_verify_mode(ssl::verify_none);  // Accept self-signed certs
+		// Sessions are kept here rather than in OpenSSL's internal cache, which a client does not look up.
+		SSL_CTX_set_session_cache_mode(m_context.native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_set_ex_data(m_context.native_handle(), GetContextDataIndex(), this);
+		SSL_CTX_sess_set_new_cb(m_context.native_handle(), &TlsClientContext::OnNewSession);
+	}
+	TlsClientContext(const TlsClientContext&) = delete;
+	auto operator=(const TlsClientContext&) -> TlsClientContext & = delete;
+	~TlsClientContext()
+	{
+		Invalidate();
+	}
+
+	auto GetContext() noexcept -> ssl::context&
+	{
+		return m_context;
+	}
+
+	/**
+	 * \brief	Sets the server name (SNI, which the server's ticket keys may depend on) and offers the session of the host, if there is one.
+	 * \remarks	An address is not a server name (RFC 6066), a host given as an address is not sent, and its sessions are not kept.
+	 */
+	void PrepareHandshake(SSL* const connection, const std::string& host)
+	{
+		boost::system::error_code ec;
+		asio::ip::make_address(host, ec);
+		if (!ec)
+			return;
+		SSL_set_tlsext_host_name(connection, host.c_str());
+		if (!m_session || m_sessionHost != host)
+			return;
+		// A copy as well, so the kept session is not marked as not resumable along with the connection's.
+		if (SSL_SESSION* const offered = SSL_SESSION_dup(m_session))
+		{
+			SSL_set_session(connection, offered);
+			SSL_SESSION_free(offered);
+		}
+		if (SSL_SESSION_get_protocol_version(m_session) >= TLS1_3_VERSION)
+			Invalidate();
+	}
+
+	/**
+	 * \brief	Counts the completed handshake as resumed or full.
+	 */
+	void OnHandshakeCompleted(SSL* const connection, const std::chrono::steady_clock::duration handshakeTime)
+	{
+		const bool wasResumed = SSL_session_reused(connection) == 1;
+		GetTlsHandshakeMetricsInstance().RecordHandshake(wasResumed, handshakeTime);
+		LogDebug("[TLS] {} handshake in {}us", wasResumed ? "Resumed" : "Full",
+			std::chrono::duration_cast<std::chrono::microseconds>(handshakeTime).count());
+	}
+
+	/**
+	 * \brief	Drops the session, the next handshake is a full one.
+	 */
+	void Invalidate() noexcept
+	{
+		if (m_session)
+			SSL_SESSION_free(m_session);
+		m_session = nullptr;
+	}
+private:
+	// Asio keeps its own callbacks in the context's app data, so this is found through an index of its own.
+	static auto GetContextDataIndex() -> int
+	{
+		static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+		return index;
+	}
+
+	// Keeps a copy of the session when it can be resumed. Not the connection's own, OpenSSL marks that one not resumable when the connection
+	// ends without a TLS shutdown (a dropped connection), which since TLS 1.1 does not prevent resuming the session (RFC 5246 section 7.2.1).
+	static auto OnNewSession(SSL* const connection, SSL_SESSION* const session) -> int
+	{
+		auto* const self = static_cast<TlsClientContext*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(connection), GetContextDataIndex()));
+		const char* const host = SSL_get_servername(connection, TLSEXT_NAMETYPE_host_name);
+		if (self == nullptr || host == nullptr || SSL_SESSION_is_resumable(session) != 1)
+			return 0;
+		SSL_SESSION* const copy = SSL_SESSION_dup(session);
+		if (copy == nullptr)
+			return 0;
+		self->Invalidate();
+		self->m_session = copy;
+		self->m_sessionHost = host;
+		return 0;
+	}
+};
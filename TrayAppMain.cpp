@@ -23,6 +23,7 @@
 #define ID_TRAY_USER_TOKEN 1004
 //#define ID_TRAY_DISABLE_CONNECTION 1005
 #define ID_TRAY_TOGGLE_CONNECTION 1005
+#define ID_TRAY_DUMP_LATENCY 1006
 #define ID_TRAY_UUID_BASE 3000
 
 
@@ -95,6 +96,7 @@ void InitTrayIcon(HWND hwnd) {
     AppendMenuW(hTrayMenu, MF_STRING, ID_TRAY_USER_TOKEN, L"Set User Token");
     AppendMenuW(hTrayMenu, MF_SEPARATOR, 0, nullptr);
     AppendMenuW(hTrayMenu, MF_STRING, ID_TRAY_TOGGLE_CONNECTION, L"Disable WebSocket Connection");
+    AppendMenuW(hTrayMenu, MF_STRING, ID_TRAY_DUMP_LATENCY, L"Log Input Latency");
     AppendMenuW(hTrayMenu, MF_SEPARATOR, 0, nullptr);
     AppendMenuW(hTrayMenu, MF_STRING, ID_TRAY_EXIT, L"Exit");
 
@@ -269,6 +271,9 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             }
             UpdateConnectionMenuCheckmark();
             break;
+        case ID_TRAY_DUMP_LATENCY:
+            GetInputLatencyInstance().Dump();
+            break;
 
         }
         return 0;
@@ -329,7 +334,7 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int)
             if (trustedClientUUIDs.empty() && !clients.empty()) {
                 const auto& firstUUID = *clients.begin();
                 trustedClientUUIDs.insert(firstUUID);
-                std::cout << "[INFO] Auto-trusted first client: " << firstUUID << "\n";
+                LogInfo("[INFO] Auto-trusted first client: {}", firstUUID);
             }
 
             PostMessage(g_hwnd, WM_APP + 1, 0, 0);